@@ -13,6 +13,7 @@ import Init.Data.Int
 import Init.Data.Array
 import Init.Data.ByteArray
 import Init.Data.FloatArray
+import Init.Data.ScalarArray
 import Init.Data.Fin
 import Init.Data.UInt
 import Init.Data.Float
@@ -177,6 +177,30 @@ def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → UInt8 →
 def foldl {β : Type v} (f : β → UInt8 → β) (init : β) (as : ByteArray) (start := 0) (stop := as.size) : β :=
   Id.run <| as.foldlM f init start stop
 
+/-- Set all the bytes of `a` to `v`. `a` is updated in place if it is not shared. -/
+@[extern "lean_byte_array_fill"]
+def fill (a : ByteArray) (v : UInt8) : ByteArray :=
+  ⟨a.data.map fun _ => v⟩
+
+/-- Byte-wise equality, implemented using `memcmp`. -/
+@[extern "lean_byte_array_beq"]
+protected def beq (a b : @& ByteArray) : Bool :=
+  a.data == b.data
+
+instance : BEq ByteArray := ⟨ByteArray.beq⟩
+
+/-- Return the index of the first occurrence of `v` at or after `start`, or `a.size` if there is none.
+  Implemented using `memchr`. -/
+@[extern "lean_byte_array_index_of"]
+def indexOf (a : @& ByteArray) (v : UInt8) (start : @& Nat := 0) : Nat :=
+  (a.findIdx? (· == v) start).getD a.size
+
+/-- Hash of the bytes of `a`. Byte arrays and strings with the same bytes have the same hash. -/
+@[extern "lean_byte_array_hash"]
+protected opaque hash (a : @& ByteArray) : UInt64
+
+instance : Hashable ByteArray := ⟨ByteArray.hash⟩
+
 end ByteArray
 
 def List.toByteArray (bs : List UInt8) : ByteArray :=
@@ -158,6 +158,72 @@ def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → Float →
 def foldl {β : Type v} (f : β → Float → β) (init : β) (as : FloatArray) (start := 0) (stop := as.size) : β :=
   Id.run <| as.foldlM f init start stop
 
+/-!
+Bulk operations. They are implemented by loops that the C compiler vectorizes, and the operations producing a
+`FloatArray` update their first `FloatArray` argument in place if it is not shared.
+The element-wise operations on two arrays `a` and `b` only update the first `min a.size b.size` elements of `a`.
+-/
+
+/-- `a[i] := f a[i] b[i]` for all `i < min a.size b.size`. -/
+@[inline] def zipWith (a : FloatArray) (b : FloatArray) (f : Float → Float → Float) : FloatArray :=
+  let rec @[specialize] loop (n i : Nat) (a : FloatArray) : FloatArray :=
+    match n with
+    | 0   => a
+    | n+1 => loop n (i+1) (a.set! i (f (a.get! i) (b.get! i)))
+  loop (Nat.min a.size b.size) 0 a
+
+/-- Set all the elements of `a` to `v`. -/
+@[extern "lean_float_array_fill"]
+def fill (a : FloatArray) (v : Float) : FloatArray :=
+  ⟨a.data.map fun _ => v⟩
+
+@[extern "lean_float_array_add"]
+protected def add (a : FloatArray) (b : @& FloatArray) : FloatArray :=
+  a.zipWith b (· + ·)
+
+@[extern "lean_float_array_sub"]
+protected def sub (a : FloatArray) (b : @& FloatArray) : FloatArray :=
+  a.zipWith b (· - ·)
+
+@[extern "lean_float_array_mul"]
+protected def mul (a : FloatArray) (b : @& FloatArray) : FloatArray :=
+  a.zipWith b (· * ·)
+
+/-- Multiply all the elements of `a` by `c`. -/
+@[extern "lean_float_array_scale"]
+def scale (a : FloatArray) (c : Float) : FloatArray :=
+  ⟨a.data.map (c * ·)⟩
+
+/-- `y[i] := y[i] + c * x[i]` -/
+@[extern "lean_float_array_axpy"]
+def axpy (c : Float) (x : @& FloatArray) (y : FloatArray) : FloatArray :=
+  y.zipWith x fun v u => v + c * u
+
+/-- Sum of the elements of `a`. The runtime adds the elements in a different order than `foldl`,
+  so the result may differ in rounding. -/
+@[extern "lean_float_array_sum"]
+def sum (a : @& FloatArray) : Float :=
+  a.foldl (· + ·) (UInt64.toFloat 0)
+
+/-- Sum of `a[i] * b[i]` for all `i < min a.size b.size`. See `sum` for rounding. -/
+@[extern "lean_float_array_dot"]
+def dot (a b : @& FloatArray) : Float :=
+  let rec loop (n i : Nat) (s : Float) : Float :=
+    match n with
+    | 0   => s
+    | n+1 => loop n (i+1) (s + a.get! i * b.get! i)
+  loop (Nat.min a.size b.size) 0 (UInt64.toFloat 0)
+
+/-- Smallest element of `a`, ignoring `NaN`s. It is `∞` if `a` is empty. -/
+@[extern "lean_float_array_min"]
+protected def min (a : @& FloatArray) : Float :=
+  a.foldl (fun m v => if v < m then v else m) (UInt64.toFloat 1 / UInt64.toFloat 0)
+
+/-- Largest element of `a`, ignoring `NaN`s. It is `-∞` if `a` is empty. -/
+@[extern "lean_float_array_max"]
+protected def max (a : @& FloatArray) : Float :=
+  a.foldl (fun m v => if m < v then v else m) (-(UInt64.toFloat 1 / UInt64.toFloat 0))
+
 end FloatArray
 
 def List.toFloatArray (ds : List Float) : FloatArray :=
@@ -59,6 +59,20 @@ instance : Ord USize where
 instance : Ord Char where
   compare x y := compareOfLessAndEq x y
 
+/-- Lexicographic order on bytes, implemented using `memcmp`. -/
+@[extern "lean_byte_array_compare"]
+protected def ByteArray.compare (a b : @& ByteArray) : Ordering :=
+  let rec go : List UInt8 → List UInt8 → Ordering
+    | [],    []    => .eq
+    | [],    _     => .lt
+    | _,     []    => .gt
+    | x::xs, y::ys => match compare x y with
+      | .eq => go xs ys
+      | o   => o
+  go a.toList b.toList
+
+instance : Ord ByteArray where
+  compare := ByteArray.compare
 
 def ltOfOrd [Ord α] : LT α where
   lt a b := compare a b == Ordering.lt
@@ -0,0 +1,10 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.ScalarArray.Basic
+import Init.Data.ScalarArray.UInt16Array
+import Init.Data.ScalarArray.UInt32Array
+import Init.Data.ScalarArray.UInt64Array
+import Init.Data.ScalarArray.SoA
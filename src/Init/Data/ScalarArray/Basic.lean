@@ -0,0 +1,132 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.ByteArray
+import Init.Data.FloatArray
+
+/--
+Arrays of unboxed scalars of type `α`: `ByteArray`, `UInt16Array`, `UInt32Array`, `UInt64Array`, and `FloatArray`.
+The runtime stores them in a `lean_sarray_object` and updates unshared arrays destructively.
+Code that is generic over the element type should be `@[specialize]`d so that the accesses are compiled to the
+unboxed primitives of the instance.
+
+Note that `Array UInt32` and friends are not affected: they still store their elements boxed, since neither
+`ExplicitBoxing` nor `EmitC` specialize the representation of `Array` to the element type. Use `ofArray` and
+`toArray` to convert at the boundary of numeric code. Arrays of structures with scalar fields are covered by
+`deriving SoA`, which stores each field in its own scalar array.
+-/
+class ScalarArray (γ : Type) (α : outParam Type) where
+  mkEmpty : Nat → γ
+  size    : γ → Nat
+  push    : γ → α → γ
+  get!    : γ → Nat → α
+  set!    : γ → Nat → α → γ
+  uget    : (a : γ) → (i : USize) → i.toNat < size a → α
+  uset    : (a : γ) → (i : USize) → α → i.toNat < size a → γ
+
+namespace ScalarArray
+
+def empty [ScalarArray γ α] : γ :=
+  mkEmpty 0
+
+def isEmpty [ScalarArray γ α] (a : γ) : Bool :=
+  size a == 0
+
+def get? [ScalarArray γ α] (a : γ) (i : Nat) : Option α :=
+  if i < size a then some (get! a i) else none
+
+@[specialize] def ofList [ScalarArray γ α] (as : List α) : γ :=
+  as.foldl push (mkEmpty as.length)
+
+@[specialize] def toList [ScalarArray γ α] (a : γ) : List α :=
+  let rec loop (i : Nat) (r : List α) : List α :=
+    match i with
+    | 0   => r
+    | i+1 => loop i (get! a i :: r)
+  loop (size a) []
+
+@[specialize] def ofArray [ScalarArray γ α] (as : Array α) : γ :=
+  as.foldl push (mkEmpty as.size)
+
+@[specialize] def toArray [ScalarArray γ α] (a : γ) : Array α :=
+  let rec loop (n : Nat) (i : Nat) (r : Array α) : Array α :=
+    match n with
+    | 0   => r
+    | n+1 => loop n (i+1) (r.push (get! a i))
+  loop (size a) 0 (Array.mkEmpty (size a))
+
+/--
+  We claim this unsafe implementation is correct because an array cannot have more than `usizeSz` elements in our runtime.
+  This is similar to the `Array` version.
+-/
+@[inline] unsafe def forInUnsafe {β : Type v} {m : Type v → Type w} [ScalarArray γ α] [Monad m] (as : γ) (b : β) (f : α → β → m (ForInStep β)) : m β :=
+  let sz := USize.ofNat (size as)
+  let rec @[specialize] loop (i : USize) (b : β) : m β := do
+    if i < sz then
+      match (← f (uget as i lcProof) b) with
+      | ForInStep.done  b => pure b
+      | ForInStep.yield b => loop (i+1) b
+    else
+      pure b
+  loop 0 b
+
+/-- Reference implementation for `forIn` -/
+@[implementedBy forInUnsafe]
+protected def forIn {β : Type v} {m : Type v → Type w} [ScalarArray γ α] [Monad m] (as : γ) (b : β) (f : α → β → m (ForInStep β)) : m β :=
+  let rec loop (i : Nat) (j : Nat) (b : β) : m β := do
+    match i with
+    | 0   => pure b
+    | i+1 =>
+      match (← f (get! as j) b) with
+      | ForInStep.done b  => pure b
+      | ForInStep.yield b => loop i (j+1) b
+  loop (size as) 0 b
+
+/-- See comment at `forInUnsafe` -/
+@[inline]
+unsafe def foldlMUnsafe {β : Type v} {m : Type v → Type w} [ScalarArray γ α] [Monad m] (f : β → α → m β) (init : β) (as : γ) (start := 0) (stop := size as) : m β :=
+  let rec @[specialize] fold (i : USize) (stop : USize) (b : β) : m β := do
+    if i == stop then
+      pure b
+    else
+      fold (i+1) stop (← f b (uget as i lcProof))
+  let stop := min stop (size as)
+  if start < stop then
+    fold (USize.ofNat start) (USize.ofNat stop) init
+  else
+    pure init
+
+/-- Reference implementation for `foldlM` -/
+@[implementedBy foldlMUnsafe]
+def foldlM {β : Type v} {m : Type v → Type w} [ScalarArray γ α] [Monad m] (f : β → α → m β) (init : β) (as : γ) (start := 0) (stop := size as) : m β :=
+  let rec loop (i : Nat) (j : Nat) (b : β) : m β := do
+    match i with
+    | 0   => pure b
+    | i+1 => loop i (j+1) (← f b (get! as j))
+  loop (min stop (size as) - start) start init
+
+@[inline]
+def foldl {β : Type v} [ScalarArray γ α] (f : β → α → β) (init : β) (as : γ) (start := 0) (stop := size as) : β :=
+  Id.run <| foldlM f init as start stop
+
+end ScalarArray
+
+instance : ScalarArray ByteArray UInt8 where
+  mkEmpty := ByteArray.mkEmpty
+  size    := ByteArray.size
+  push    := ByteArray.push
+  get!    := ByteArray.get!
+  set!    := ByteArray.set!
+  uget    := ByteArray.uget
+  uset    := ByteArray.uset
+
+instance : ScalarArray FloatArray Float where
+  mkEmpty := FloatArray.mkEmpty
+  size    := FloatArray.size
+  push    := FloatArray.push
+  get!    := FloatArray.get!
+  set!    := FloatArray.set!
+  uget    := FloatArray.uget
+  uset    := FloatArray.uset
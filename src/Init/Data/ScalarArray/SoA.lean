@@ -0,0 +1,44 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.ScalarArray.Basic
+import Init.Data.Array.Basic
+
+/--
+Struct-of-arrays representation `γ` of arrays of structures `α`: each field of `α` is stored in its own
+`ScalarArray` column. Compared to `Array α`, the elements are not boxed, and a loop that only reads some fields
+only touches their columns.
+
+As for `ScalarArray`, the element type `α` is determined by the array type `γ`. `deriving SoA` generates the type
+`α.SoA` and the instance `SoA α.SoA α` for structures without parameters whose fields are `UInt8`, `UInt16`,
+`UInt32`, `UInt64`, or `Float`. The generated `push` and `set!` take the columns apart, so they are updated
+destructively when the `α.SoA` value is not shared.
+-/
+class SoA (γ : Type) (α : outParam Type) where
+  mkEmpty : Nat → γ
+  size    : γ → Nat
+  push    : γ → α → γ
+  get!    : γ → Nat → α
+  set!    : γ → Nat → α → γ
+
+namespace SoA
+
+def empty [SoA γ α] : γ :=
+  mkEmpty 0
+
+@[specialize] def ofArray [SoA γ α] (as : Array α) : γ :=
+  as.foldl push (mkEmpty as.size)
+
+@[specialize] def foldl [SoA γ α] (f : β → α → β) (init : β) (a : γ) : β :=
+  let rec loop (n : Nat) (i : Nat) (b : β) : β :=
+    match n with
+    | 0   => b
+    | n+1 => loop n (i+1) (f b (get! a i))
+  loop (size a) 0 init
+
+@[specialize] def toArray [SoA γ α] (a : γ) : Array α :=
+  foldl (fun (r : Array α) v => r.push v) (Array.mkEmpty (size a)) a
+
+end SoA
@@ -0,0 +1,78 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.ScalarArray.Basic
+
+/-!
+`UInt16Array` is an array of unboxed `UInt16` values. Only the primitives implemented by the runtime are defined here; generic
+operations such as `ScalarArray.foldl` are shared by all scalar arrays.
+-/
+
+structure UInt16Array where
+  data : Array UInt16
+
+attribute [extern "lean_uint16_array_mk"] UInt16Array.mk
+attribute [extern "lean_uint16_array_data"] UInt16Array.data
+
+namespace UInt16Array
+@[extern "lean_mk_empty_uint16_array"]
+def mkEmpty (c : @& Nat) : UInt16Array :=
+  { data := #[] }
+
+def empty : UInt16Array :=
+  mkEmpty 0
+
+@[extern "lean_uint16_array_push"]
+def push : UInt16Array → UInt16 → UInt16Array
+  | ⟨ds⟩, b => ⟨ds.push b⟩
+
+@[extern "lean_uint16_array_size"]
+def size : (@& UInt16Array) → Nat
+  | ⟨ds⟩ => ds.size
+
+@[extern "lean_uint16_array_uget"]
+def uget : (a : @& UInt16Array) → (i : USize) → i.toNat < a.size → UInt16
+  | ⟨ds⟩, i, h => ds[i]
+
+@[extern "lean_uint16_array_fget"]
+def get : (ds : @& UInt16Array) → (@& Fin ds.size) → UInt16
+  | ⟨ds⟩, i => ds.get i
+
+@[extern "lean_uint16_array_get"]
+def get! : (@& UInt16Array) → (@& Nat) → UInt16
+  | ⟨ds⟩, i => ds.get! i
+
+@[extern "lean_uint16_array_uset"]
+def uset : (a : UInt16Array) → (i : USize) → UInt16 → i.toNat < a.size → UInt16Array
+  | ⟨ds⟩, i, v, h => ⟨ds.uset i v h⟩
+
+@[extern "lean_uint16_array_fset"]
+def set : (ds : UInt16Array) → (@& Fin ds.size) → UInt16 → UInt16Array
+  | ⟨ds⟩, i, d => ⟨ds.set i d⟩
+
+@[extern "lean_uint16_array_set"]
+def set! : UInt16Array → (@& Nat) → UInt16 → UInt16Array
+  | ⟨ds⟩, i, d => ⟨ds.set! i d⟩
+
+end UInt16Array
+
+instance : ScalarArray UInt16Array UInt16 where
+  mkEmpty := UInt16Array.mkEmpty
+  size    := UInt16Array.size
+  push    := UInt16Array.push
+  get!    := UInt16Array.get!
+  set!    := UInt16Array.set!
+  uget    := UInt16Array.uget
+  uset    := UInt16Array.uset
+
+instance : Inhabited UInt16Array := ⟨UInt16Array.empty⟩
+instance : EmptyCollection UInt16Array := ⟨UInt16Array.empty⟩
+instance : GetElem UInt16Array Nat UInt16 fun xs i => i < xs.size := ⟨fun xs i h => xs.get ⟨i, h⟩⟩
+instance : GetElem UInt16Array USize UInt16 fun xs i => i.val < xs.size := ⟨fun xs i h => xs.uget i h⟩
+instance : ForIn m UInt16Array UInt16 := ⟨ScalarArray.forIn⟩
+instance : ToString UInt16Array := ⟨fun ds => (ScalarArray.toList ds).toString⟩
+
+def List.toUInt16Array (ds : List UInt16) : UInt16Array :=
+  ScalarArray.ofList ds
@@ -0,0 +1,78 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.ScalarArray.Basic
+
+/-!
+`UInt32Array` is an array of unboxed `UInt32` values. Only the primitives implemented by the runtime are defined here; generic
+operations such as `ScalarArray.foldl` are shared by all scalar arrays.
+-/
+
+structure UInt32Array where
+  data : Array UInt32
+
+attribute [extern "lean_uint32_array_mk"] UInt32Array.mk
+attribute [extern "lean_uint32_array_data"] UInt32Array.data
+
+namespace UInt32Array
+@[extern "lean_mk_empty_uint32_array"]
+def mkEmpty (c : @& Nat) : UInt32Array :=
+  { data := #[] }
+
+def empty : UInt32Array :=
+  mkEmpty 0
+
+@[extern "lean_uint32_array_push"]
+def push : UInt32Array → UInt32 → UInt32Array
+  | ⟨ds⟩, b => ⟨ds.push b⟩
+
+@[extern "lean_uint32_array_size"]
+def size : (@& UInt32Array) → Nat
+  | ⟨ds⟩ => ds.size
+
+@[extern "lean_uint32_array_uget"]
+def uget : (a : @& UInt32Array) → (i : USize) → i.toNat < a.size → UInt32
+  | ⟨ds⟩, i, h => ds[i]
+
+@[extern "lean_uint32_array_fget"]
+def get : (ds : @& UInt32Array) → (@& Fin ds.size) → UInt32
+  | ⟨ds⟩, i => ds.get i
+
+@[extern "lean_uint32_array_get"]
+def get! : (@& UInt32Array) → (@& Nat) → UInt32
+  | ⟨ds⟩, i => ds.get! i
+
+@[extern "lean_uint32_array_uset"]
+def uset : (a : UInt32Array) → (i : USize) → UInt32 → i.toNat < a.size → UInt32Array
+  | ⟨ds⟩, i, v, h => ⟨ds.uset i v h⟩
+
+@[extern "lean_uint32_array_fset"]
+def set : (ds : UInt32Array) → (@& Fin ds.size) → UInt32 → UInt32Array
+  | ⟨ds⟩, i, d => ⟨ds.set i d⟩
+
+@[extern "lean_uint32_array_set"]
+def set! : UInt32Array → (@& Nat) → UInt32 → UInt32Array
+  | ⟨ds⟩, i, d => ⟨ds.set! i d⟩
+
+end UInt32Array
+
+instance : ScalarArray UInt32Array UInt32 where
+  mkEmpty := UInt32Array.mkEmpty
+  size    := UInt32Array.size
+  push    := UInt32Array.push
+  get!    := UInt32Array.get!
+  set!    := UInt32Array.set!
+  uget    := UInt32Array.uget
+  uset    := UInt32Array.uset
+
+instance : Inhabited UInt32Array := ⟨UInt32Array.empty⟩
+instance : EmptyCollection UInt32Array := ⟨UInt32Array.empty⟩
+instance : GetElem UInt32Array Nat UInt32 fun xs i => i < xs.size := ⟨fun xs i h => xs.get ⟨i, h⟩⟩
+instance : GetElem UInt32Array USize UInt32 fun xs i => i.val < xs.size := ⟨fun xs i h => xs.uget i h⟩
+instance : ForIn m UInt32Array UInt32 := ⟨ScalarArray.forIn⟩
+instance : ToString UInt32Array := ⟨fun ds => (ScalarArray.toList ds).toString⟩
+
+def List.toUInt32Array (ds : List UInt32) : UInt32Array :=
+  ScalarArray.ofList ds
@@ -0,0 +1,78 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.ScalarArray.Basic
+
+/-!
+`UInt64Array` is an array of unboxed `UInt64` values. Only the primitives implemented by the runtime are defined here; generic
+operations such as `ScalarArray.foldl` are shared by all scalar arrays.
+-/
+
+structure UInt64Array where
+  data : Array UInt64
+
+attribute [extern "lean_uint64_array_mk"] UInt64Array.mk
+attribute [extern "lean_uint64_array_data"] UInt64Array.data
+
+namespace UInt64Array
+@[extern "lean_mk_empty_uint64_array"]
+def mkEmpty (c : @& Nat) : UInt64Array :=
+  { data := #[] }
+
+def empty : UInt64Array :=
+  mkEmpty 0
+
+@[extern "lean_uint64_array_push"]
+def push : UInt64Array → UInt64 → UInt64Array
+  | ⟨ds⟩, b => ⟨ds.push b⟩
+
+@[extern "lean_uint64_array_size"]
+def size : (@& UInt64Array) → Nat
+  | ⟨ds⟩ => ds.size
+
+@[extern "lean_uint64_array_uget"]
+def uget : (a : @& UInt64Array) → (i : USize) → i.toNat < a.size → UInt64
+  | ⟨ds⟩, i, h => ds[i]
+
+@[extern "lean_uint64_array_fget"]
+def get : (ds : @& UInt64Array) → (@& Fin ds.size) → UInt64
+  | ⟨ds⟩, i => ds.get i
+
+@[extern "lean_uint64_array_get"]
+def get! : (@& UInt64Array) → (@& Nat) → UInt64
+  | ⟨ds⟩, i => ds.get! i
+
+@[extern "lean_uint64_array_uset"]
+def uset : (a : UInt64Array) → (i : USize) → UInt64 → i.toNat < a.size → UInt64Array
+  | ⟨ds⟩, i, v, h => ⟨ds.uset i v h⟩
+
+@[extern "lean_uint64_array_fset"]
+def set : (ds : UInt64Array) → (@& Fin ds.size) → UInt64 → UInt64Array
+  | ⟨ds⟩, i, d => ⟨ds.set i d⟩
+
+@[extern "lean_uint64_array_set"]
+def set! : UInt64Array → (@& Nat) → UInt64 → UInt64Array
+  | ⟨ds⟩, i, d => ⟨ds.set! i d⟩
+
+end UInt64Array
+
+instance : ScalarArray UInt64Array UInt64 where
+  mkEmpty := UInt64Array.mkEmpty
+  size    := UInt64Array.size
+  push    := UInt64Array.push
+  get!    := UInt64Array.get!
+  set!    := UInt64Array.set!
+  uget    := UInt64Array.uget
+  uset    := UInt64Array.uset
+
+instance : Inhabited UInt64Array := ⟨UInt64Array.empty⟩
+instance : EmptyCollection UInt64Array := ⟨UInt64Array.empty⟩
+instance : GetElem UInt64Array Nat UInt64 fun xs i => i < xs.size := ⟨fun xs i h => xs.get ⟨i, h⟩⟩
+instance : GetElem UInt64Array USize UInt64 fun xs i => i.val < xs.size := ⟨fun xs i h => xs.uget i h⟩
+instance : ForIn m UInt64Array UInt64 := ⟨ScalarArray.forIn⟩
+instance : ToString UInt64Array := ⟨fun ds => (ScalarArray.toList ds).toString⟩
+
+def List.toUInt64Array (ds : List UInt64) : UInt64Array :=
+  ScalarArray.ofList ds
@@ -91,6 +91,46 @@ set_option compiler.extract_closed false in
 @[extern "lean_io_timeit"] opaque timeit (msg : @& String) (fn : IO α) : IO α
 @[extern "lean_io_allocprof"] opaque allocprof (msg : @& String) (fn : IO α) : IO α
 
+/--
+Starts the sampling allocation profiler. From now on, every thread records roughly one in `interval`
+small object allocations (and one in `interval / 64` big ones) together with the allocating function,
+the size class of the object, and how long it stays alive. The allocating function is taken from the
+IR interpreter call stack if the code is interpreted, and from the native call stack otherwise.
+The sampler is only available if Lean was compiled with `ALLOC_SAMPLER=ON`, otherwise an error is thrown.
+-/
+@[extern "lean_io_start_alloc_sampler"] opaque startAllocSampler (interval : USize := 4096) : IO Unit
+
+/--
+Stops the sampling allocation profiler started by `startAllocSampler` and writes the samples to `fname`
+in the pprof format, e.g. for use with `pprof -top -sample_index=alloc_space lean profile.pb`.
+Objects that are still alive contribute to `inuse_space`.
+-/
+@[extern "lean_io_stop_alloc_sampler"] opaque stopAllocSampler (fname : @& FilePath) : IO Unit
+
+/--
+Enables deferred-free mode if `budgetUs` is not zero: dropping the last reference to a large object graph
+then spends at most about `budgetUs` microseconds freeing it. The remaining objects are freed by a background
+thread if they are shared between threads, and otherwise incrementally by later deallocations on the same thread.
+A thread frees all its postponed objects at once when it has postponed too many graphs.
+This bounds the pause caused by dropping e.g. a whole `Environment`.
+Finalizers of objects whose deletion is postponed, e.g. closing a file `Handle`, may thus run late.
+`budgetUs = 0` restores the default eager mode, and frees the objects postponed by the current thread.
+-/
+@[extern "lean_io_set_deferred_free_budget"] opaque setDeferredFreeBudget (budgetUs : USize) : BaseIO Unit
+
+/--
+Frees the objects whose deletion has been postponed by the current thread in deferred-free mode, and returns
+their number. See `setDeferredFreeBudget`.
+-/
+@[extern "lean_io_free_deferred"] opaque freeDeferred : BaseIO Nat
+
+/--
+Returns the histogram of the pauses spent freeing object graphs while `allocprof` is running.
+Bucket `i` counts the pauses shorter than `2^i` microseconds that do not fit into a smaller bucket,
+and the last bucket counts all longer pauses.
+-/
+@[extern "lean_io_get_free_pause_histogram"] opaque getFreePauseHistogram : BaseIO (Array Nat)
+
 /-- Programs can execute IO actions during initialization that occurs before
    the `main` function is executed. The attribute `[init <action>]` specifies
    which IO action is executed to set the value of an opaque constant.
@@ -266,6 +306,15 @@ private def fopenFlags (m : FS.Mode) (b : Bool) : String :=
 def mk (fn : FilePath) (Mode : Mode) (bin : Bool := true) : IO Handle :=
   mkPrim fn (fopenFlags Mode bin)
 
+@[extern "lean_io_prim_handle_mk_buffered"] opaque mkBufferedPrim (fn : @& FilePath) (mode : @& String) (bufferSize : USize) : IO Handle
+
+/--
+Like `Handle.mk`, but uses an I/O buffer of `bufferSize` bytes instead of the platform default.
+A `bufferSize` of `0` creates an unbuffered handle.
+-/
+def mkBuffered (fn : FilePath) (Mode : Mode) (bufferSize : USize) (bin : Bool := true) : IO Handle :=
+  mkBufferedPrim fn (fopenFlags Mode bin) bufferSize
+
 /--
 Returns whether the end of the file has been reached while reading a file.
 `h.isEof` returns true /after/ the first attempt at reading past the end of `h`.
@@ -279,6 +328,38 @@ Once `h.isEof` is true, reading `h` will always return an empty array.
 @[extern "lean_io_prim_handle_get_line"] opaque getLine (h : @& Handle) : IO String
 @[extern "lean_io_prim_handle_put_str"] opaque putStr (h : @& Handle) (s : @& String) : IO Unit
 
+/--
+Reads the remaining contents of `h`. For regular files, the resulting array is allocated only once,
+using the remaining size of the file.
+-/
+@[extern "lean_io_prim_handle_read_bin_to_end"] opaque readBinToEnd (h : @& Handle) : IO ByteArray
+
+/--
+Maps the whole file underlying `h` into memory, independently of the current position of `h`.
+The mapping is private: updating the resulting array does not modify the file. It is unmapped when the
+array is freed. Modifying the file while the mapping is in use results in undefined behavior.
+On platforms without `mmap`, the file contents are read into memory instead.
+-/
+@[extern "lean_io_prim_handle_mmap"] opaque mmap (h : @& Handle) : IO ByteArray
+
+/--
+Returns a task that finishes once reading from `h` would not block, i.e. when data is available,
+the end of the file has been reached, or an error occurred.
+Waiting is done by the runtime's I/O event loop and does not occupy a task manager thread.
+On platforms without an event loop, the task is finished immediately.
+The handle, and thus its underlying file, is kept open until the task finishes.
+-/
+@[extern "lean_io_prim_handle_wait_readable"] opaque waitReadable (h : @& Handle) : BaseIO (Task Unit)
+/-- Like `waitReadable`, but waits until writing to `h` would not block. -/
+@[extern "lean_io_prim_handle_wait_writable"] opaque waitWritable (h : @& Handle) : BaseIO (Task Unit)
+/--
+Reads at most `bytes` bytes that are available without blocking, stopping after the first newline if
+`untilNewline` is set. Returns `none` if no data is available yet, and an empty array at the end of the file.
+On platforms without an event loop, this blocks like `read` and `getLine`.
+-/
+@[extern "lean_io_prim_handle_read_available"]
+opaque readAvailable (h : @& Handle) (bytes : USize) (untilNewline : Bool := false) : IO (Option ByteArray)
+
 end Handle
 
 @[extern "lean_io_realpath"] opaque realPath (fname : FilePath) : IO FilePath
@@ -302,15 +383,6 @@ def withFile (fn : FilePath) (mode : Mode) (f : Handle → IO α) : IO α :=
 def Handle.putStrLn (h : Handle) (s : String) : IO Unit :=
   h.putStr (s.push '\n')
 
-partial def Handle.readBinToEnd (h : Handle) : IO ByteArray := do
-  let rec loop (acc : ByteArray) : IO ByteArray := do
-    let buf ← h.read 1024
-    if buf.isEmpty then
-      return acc
-    else
-      loop (acc ++ buf)
-  loop ByteArray.empty
-
 partial def Handle.readToEnd (h : Handle) : IO String := do
   let rec loop (s : String) := do
     let line ← h.getLine
@@ -320,6 +392,39 @@ partial def Handle.readToEnd (h : Handle) : IO String := do
       loop (s ++ line)
   loop ""
 
+private partial def Handle.readAsyncAux (h : Handle) (bytes : USize) (prio : Task.Priority) : IO (Task (Except IO.Error ByteArray)) := do
+  IO.bindTask (← h.waitReadable) (prio := prio) fun _ => do
+    match (← h.readAvailable bytes) with
+    | some data => return Task.pure (.ok data)
+    | none      => h.readAsyncAux bytes prio
+
+/--
+Asynchronous version of `Handle.read`. Waits on the runtime's I/O event loop until `h` is readable and then
+reads only the data that is available without blocking, so that no thread is blocked while waiting for data.
+Like `read`, it may return fewer than `bytes` bytes, and returns an empty array at the end of the file.
+-/
+def Handle.readAsync (h : Handle) (bytes : USize) (prio := Task.Priority.default) : BaseIO (Task (Except IO.Error ByteArray)) :=
+  (h.readAsyncAux bytes prio).catchExceptions fun e => return Task.pure (.error e)
+
+private partial def Handle.getLineAsyncAux (h : Handle) (line : ByteArray) (prio : Task.Priority) : IO (Task (Except IO.Error String)) := do
+  IO.bindTask (← h.waitReadable) (prio := prio) fun _ => do
+    match (← h.readAvailable 4096 (untilNewline := true)) with
+    | none      => h.getLineAsyncAux line prio
+    | some data =>
+      let line := line ++ data
+      if data.isEmpty || data.get! (data.size - 1) == 10 then
+        return Task.pure (.ok (String.fromUTF8Unchecked line))
+      else
+        h.getLineAsyncAux line prio
+
+/-- Asynchronous version of `Handle.getLine`, see `Handle.readAsync`. The line may arrive in several parts. -/
+def Handle.getLineAsync (h : Handle) (prio := Task.Priority.default) : BaseIO (Task (Except IO.Error String)) :=
+  (h.getLineAsyncAux ByteArray.empty prio).catchExceptions fun e => return Task.pure (.error e)
+
+/-- Asynchronous version of `Handle.write`. The write is started as a task only once `h` is writable. -/
+def Handle.writeAsync (h : Handle) (buffer : ByteArray) (prio := Task.Priority.default) : BaseIO (Task (Except IO.Error Unit)) := do
+  EIO.bindTask (← h.waitWritable) (fun _ => IO.asTask (h.write buffer) prio) prio
+
 def readBinFile (fname : FilePath) : IO ByteArray := do
   let h ← Handle.mk fname Mode.read true
   h.readBinToEnd
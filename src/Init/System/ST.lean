@@ -70,6 +70,11 @@ opaque Ref.swap {σ α} (r : @& Ref σ α) (a : α) : ST σ α := inhabitedFromR
 unsafe opaque Ref.take {σ α} (r : @& Ref σ α) : ST σ α := inhabitedFromRef r
 @[extern "lean_st_ref_ptr_eq"]
 opaque Ref.ptrEq {σ α} (r1 r2 : @& Ref σ α) : ST σ Bool
+/--
+Stores `new` in `r` if `r` currently contains the object `expected` (using pointer equality),
+and returns whether it did so. The operation is atomic even if `r` is shared between threads. -/
+@[extern "lean_st_ref_ptr_compare_and_swap"]
+unsafe opaque Ref.ptrCompareAndSwap {σ α} (r : @& Ref σ α) (expected : @& α) (new : α) : ST σ Bool
 
 @[inline] unsafe def Ref.modifyUnsafe {σ α : Type} (r : Ref σ α) (f : α → α) : ST σ Unit := do
   let v ← Ref.take r
@@ -81,6 +86,25 @@ opaque Ref.ptrEq {σ α} (r1 r2 : @& Ref σ α) : ST σ Bool
   Ref.set r a
   pure b
 
+@[specialize] unsafe def Ref.compareAndSwapUnsafe {σ α : Type} [BEq α] (r : Ref σ α) (expected new : α) : ST σ Bool := do
+  let v ← Ref.get r
+  if v == expected then
+    if (← Ref.ptrCompareAndSwap r v new) then
+      pure true
+    else
+      -- `r` was modified concurrently after we read it
+      Ref.compareAndSwapUnsafe r expected new
+  else
+    pure false
+
+@[specialize] unsafe def Ref.modifyGetLockFreeUnsafe {σ α β : Type} (r : Ref σ α) (f : α → β × α) : ST σ β := do
+  let v ← Ref.get r
+  let (b, a) := f v
+  if (← Ref.ptrCompareAndSwap r v a) then
+    pure b
+  else
+    Ref.modifyGetLockFreeUnsafe r f
+
 @[implementedBy Ref.modifyUnsafe]
 def Ref.modify {σ α : Type} (r : Ref σ α) (f : α → α) : ST σ Unit := do
   let v ← Ref.get r
@@ -93,6 +117,24 @@ def Ref.modifyGet {σ α β : Type} (r : Ref σ α) (f : α → β × α) : ST 
   Ref.set r a
   pure b
 
+/--
+Atomically replaces the value of `r` with `new` if it is equal to `expected`, and returns whether it did so. -/
+@[implementedBy Ref.compareAndSwapUnsafe]
+def Ref.compareAndSwap {σ α : Type} [BEq α] (r : Ref σ α) (expected new : α) : ST σ Bool := do
+  if (← Ref.get r) == expected then
+    Ref.set r new
+    pure true
+  else
+    pure false
+
+/--
+Like `Ref.modifyGet`, but uses a compare-and-swap loop instead of taking the value out of `r` while `f`
+is running. Thus, other threads accessing `r` never wait for `f`, but `f` may be evaluated several times
+under contention, and it cannot update the old value destructively. -/
+@[implementedBy Ref.modifyGetLockFreeUnsafe]
+def Ref.modifyGetLockFree {σ α β : Type} (r : Ref σ α) (f : α → β × α) : ST σ β :=
+  Ref.modifyGet r f
+
 end Prim
 
 section
@@ -106,6 +148,9 @@ variable {σ : Type} {m : Type → Type} [Monad m] [MonadLiftT (ST σ) m]
 @[inline] def Ref.ptrEq {α : Type} (r1 r2 : Ref σ α) : m Bool := liftM <| Prim.Ref.ptrEq r1 r2
 @[inline] def Ref.modify {α : Type} (r : Ref σ α) (f : α → α) : m Unit := liftM <| Prim.Ref.modify r f
 @[inline] def Ref.modifyGet {α : Type} {β : Type} (r : Ref σ α) (f : α → β × α) : m β := liftM <| Prim.Ref.modifyGet r f
+@[inline] def Ref.compareAndSwap {α : Type} [BEq α] (r : Ref σ α) (expected new : α) : m Bool := liftM <| Prim.Ref.compareAndSwap r expected new
+@[inline] def Ref.modifyGetLockFree {α : Type} {β : Type} (r : Ref σ α) (f : α → β × α) : m β := liftM <| Prim.Ref.modifyGetLockFree r f
+@[inline] def Ref.modifyLockFree {α : Type} (r : Ref σ α) (f : α → α) : m Unit := liftM <| Prim.Ref.modifyGetLockFree r fun a => ((), f a)
 
 end
 
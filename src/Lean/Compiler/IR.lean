@@ -29,6 +29,46 @@ register_builtin_option compiler.reuse : Bool := {
   descr    := "heuristically insert reset/reuse instruction pairs"
 }
 
+register_builtin_option compiler.reuseSizeClass : Bool := {
+  defValue := false
+  descr    := "allow reset/reuse between constructors of different types and shapes whose objects have the same allocator size class (ignored if the runtime does not use the small object allocator)"
+}
+
+/--
+Return `true` if the runtime allocates small objects by size class. Otherwise, objects are allocated with their exact
+size, and a cell cannot be reused by a bigger constructor object of the same size class.
+-/
+@[extern "lean_small_allocator_enabled"]
+opaque smallAllocatorEnabled : Unit → Bool
+
+register_builtin_option compiler.borrowExported : Bool := {
+  defValue := false
+  descr    := "perform borrow inference on the code of `@[export]` functions using an auxiliary declaration, and redirect direct calls to it; importing modules only call the auxiliary declaration if they also set this option"
+}
+
+/-- Number of `inc` and `dec` instructions in `b`. -/
+private partial def numRCInstrs : FnBody → Nat
+  | .inc _ _ _ _ b | .dec _ _ _ _ b => numRCInstrs b + 1
+  | .jdecl _ _ v b     => numRCInstrs v + numRCInstrs b
+  | .case _ _ _ alts   => alts.foldl (fun n alt => n + numRCInstrs alt.body) 0
+  | b => if b.isTerminal then 0 else numRCInstrs b.body
+
+private def declsNumRCInstrs (decls : Array Decl) : Nat :=
+  decls.foldl (init := 0) fun n decl =>
+    match decl with
+    | .fdecl (body := b) .. => n + numRCInstrs b
+    | .extern .. => n
+
+/--
+With `compiler.borrowExported`, report the number of `inc`/`dec` instructions of `decls` and of the same declarations
+compiled without ownership summaries, i.e., with the owned calling convention of `@[export]` functions.
+-/
+private def logBorrowRCStats (declsBeforeBorrow : Array Decl) (decls : Array Decl) : CompilerM Unit := do
+  if (← isLogEnabled `borrow_rc_stats) then
+    let base ← explicitRC (← explicitBoxing (← inferBorrow declsBeforeBorrow))
+    logMessageIf `borrow_rc_stats
+      s!"inc/dec instructions: {declsNumRCInstrs decls}, without ownership summaries: {declsNumRCInstrs base}"
+
 private def compileAux (decls : Array Decl) : CompilerM Unit := do
   logDecls `init decls
   checkDecls decls
@@ -37,19 +77,24 @@ private def compileAux (decls : Array Decl) : CompilerM Unit := do
   decls := decls.map Decl.pushProj
   logDecls `push_proj decls
   if compiler.reuse.get (← read) then
-    decls := decls.map Decl.insertResetReuse
+    let sizeClass := compiler.reuseSizeClass.get (← read) && smallAllocatorEnabled ()
+    decls := decls.map (Decl.insertResetReuse (sizeClass := sizeClass))
     logDecls `reset_reuse decls
   decls := decls.map Decl.elimDead
   logDecls `elim_dead decls
   decls := decls.map Decl.simpCase
   logDecls `simp_case decls
   decls := decls.map Decl.normalizeIds
-  decls ← inferBorrow decls
+  let declsBeforeBorrow := decls
+  let borrowExported := compiler.borrowExported.get (← read)
+  decls ← inferBorrow decls (borrowExported := borrowExported)
   logDecls `borrow decls
   decls ← explicitBoxing decls
   logDecls `boxing decls
   decls ← explicitRC decls
   logDecls `rc decls
+  if borrowExported then
+    logBorrowRCStats declsBeforeBorrow decls
   if compiler.reuse.get (← read) then
     decls := decls.map Decl.expandResetReuse
     logDecls `expand_reset_reuse decls
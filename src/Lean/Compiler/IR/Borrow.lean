@@ -6,6 +6,7 @@ Authors: Leonardo de Moura
 import Lean.Compiler.ExportAttr
 import Lean.Compiler.IR.CompilerM
 import Lean.Compiler.IR.NormIds
+import Lean.Compiler.IR.FreeVars
 
 namespace Lean
 namespace IR
@@ -305,12 +306,112 @@ def collectDecls : M ParamMap := do
 def infer (env : Environment) (decls : Array Decl) : ParamMap :=
   collectDecls { env, decls } |>.run' { paramMap := mkInitParamMap env decls }
 
+/-! Parameters of `@[export]` functions are never borrowed (see `initBorrowIfNotExported`).
+   To avoid paying for this restriction in Lean code, the body of an `@[export]` function `f` is moved to
+   the auxiliary declaration `f._borrowed`, which is not exported and whose parameters are inferred as usual,
+   and `f` becomes a wrapper with the owned calling convention that forwards to it. Direct calls to `f` are
+   redirected to `f._borrowed`, also in importing modules: the IR declaration of `f._borrowed` is stored in the
+   `.olean` file together with the other IR declarations, and its parameters are the ownership summary used by
+   `ExplicitRC`. If no parameter of `f._borrowed` is borrowed, the two declarations are merged again.
+   Calls are only redirected in modules compiled with `compiler.borrowExported`; other importing modules keep
+   calling the owned wrapper `f`. -/
+namespace BorrowedVersion
+
+def mkBorrowedName (n : Name) : Name :=
+  Name.mkStr n "_borrowed"
+
+def isBorrowedName : Name → Bool
+  | .str _ "_borrowed" => true
+  | _ => false
+
+/-- Return the function that should be invoked by a direct call to `f`. `localNames` maps the `@[export]`
+   functions of the current block to their `_borrowed` version. -/
+def getCallee (env : Environment) (localNames : NameMap Name) (f : FunId) : FunId :=
+  match localNames.find? f with
+  | some g => g
+  | none   =>
+    let g := mkBorrowedName f
+    if (findEnvDecl env g).isSome then g else f
+
+partial def renameCallees (rename : FunId → FunId) : FnBody → FnBody
+  | .vdecl x ty (.fap f ys) b => .vdecl x ty (.fap (rename f) ys) (renameCallees rename b)
+  | .jdecl j ys v b => .jdecl j ys (renameCallees rename v) (renameCallees rename b)
+  | .case tid x xType alts => .case tid x xType <| alts.map fun alt => alt.modifyBody (renameCallees rename)
+  | e =>
+    if e.isTerminal then e
+    else
+      let (instr, b) := e.split
+      instr.setBody (renameCallees rename b)
+
+def mkWrapper (decl : Decl) (g : FunId) : Decl :=
+  match decl with
+  | .fdecl f xs ty _ info =>
+    let r : VarId := { idx := decl.maxIndex + 1 }
+    .fdecl f xs ty (.vdecl r ty (.fap g (xs.map (Arg.var ·.x))) (.ret (.var r))) info
+  | other => other
+
+/-- Split the `@[export]` functions of `decls`, and redirect direct calls to the `_borrowed` versions. -/
+def split (env : Environment) (decls : Array Decl) : Array Decl :=
+  let localNames := decls.foldl (init := {}) fun (localNames : NameMap Name) decl =>
+    match decl with
+    | .fdecl (f := f) (xs := xs) .. =>
+      if isExport env f && xs.any (·.ty.isObj) then localNames.insert f (mkBorrowedName f) else localNames
+    | _ => localNames
+  let rename := getCallee env localNames
+  decls.foldl (init := #[]) fun decls decl =>
+    match decl with
+    | .fdecl f xs ty b info =>
+      let b := renameCallees rename b
+      match localNames.find? f with
+      | some g => decls.push (mkWrapper decl g) |>.push (.fdecl g xs ty b info)
+      | none   => decls.push (.fdecl f xs ty b info)
+    | other => decls.push other
+
+/-- Merge `f` and `f._borrowed` back when the latter does not have borrowed parameters. -/
+def merge (decls : Array Decl) : Array Decl :=
+  let merged := decls.foldl (init := {}) fun (merged : NameMap Name) decl =>
+    match decl with
+    | .fdecl (f := g) (xs := xs) .. =>
+      if isBorrowedName g && xs.all (!·.borrow) then merged.insert g g.getPrefix else merged
+    | _ => merged
+  if merged.isEmpty then decls
+  else
+    let rename f := (merged.find? f).getD f
+    let bodies := decls.foldl (init := {}) fun (bodies : NameMap FnBody) decl =>
+      match decl with
+      | .fdecl (f := g) (body := b) .. => if merged.contains g then bodies.insert g.getPrefix b else bodies
+      | _ => bodies
+    decls.filterMap fun decl =>
+      match decl with
+      | .fdecl f xs ty b info =>
+        if merged.contains f then none
+        else
+          let b := (bodies.find? f).getD b
+          some (.fdecl f xs ty (renameCallees rename b) info)
+      | other => some other
+
+def fmtSummaries (decls : Array Decl) : Format :=
+  decls.foldl (init := Format.nil) fun fmt decl =>
+    if isBorrowedName decl.name then
+      fmt ++ Format.line ++ format decl.name ++ formatParams decl.params
+    else
+      fmt
+
+end BorrowedVersion
 end Borrow
 
-def inferBorrow (decls : Array Decl) : CompilerM (Array Decl) := do
+def inferBorrow (decls : Array Decl) (borrowExported := false) : CompilerM (Array Decl) := do
   let env ← getEnv
+  let decls := if borrowExported then Borrow.BorrowedVersion.split env decls else decls
   let paramMap := Borrow.infer env decls
-  pure (Borrow.applyParamMap decls paramMap)
+  let decls := Borrow.applyParamMap decls paramMap
+  if borrowExported then
+    let decls := Borrow.BorrowedVersion.merge decls
+    if decls.any (Borrow.BorrowedVersion.isBorrowedName ·.name) then
+      logMessageIf `borrow_summary <| ("ownership summaries:" : Format) ++ Format.nest 2 (Borrow.BorrowedVersion.fmtSummaries decls)
+    pure decls
+  else
+    pure decls
 
 end IR
 end Lean
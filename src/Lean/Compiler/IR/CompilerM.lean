@@ -66,6 +66,10 @@ private def logMessageIfAux {α : Type} [ToFormat α] (optName : Name) (a : α)
 @[inline] def logMessage {α : Type} [ToFormat α] (a : α) : CompilerM Unit :=
   logMessageIfAux tracePrefixOptionName a
 
+/-- Return `true` if the messages of class `cls` are logged, e.g. to skip computing them otherwise. -/
+def isLogEnabled (cls : Name) : CompilerM Bool :=
+  return isLogEnabledFor (← read) (tracePrefixOptionName ++ cls)
+
 @[inline] def modifyEnv (f : Environment → Environment) : CompilerM Unit :=
   modify fun s => { s with env := f s.env }
 
@@ -4,6 +4,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Authors: Leonardo de Moura
 -/
 import Lean.Runtime
+import Lean.Util.SCC
 import Lean.Compiler.NameMangling
 import Lean.Compiler.ExportAttr
 import Lean.Compiler.InitAttr
@@ -12,18 +13,59 @@ import Lean.Compiler.IR.EmitUtil
 import Lean.Compiler.IR.NormIds
 import Lean.Compiler.IR.SimpCase
 import Lean.Compiler.IR.Boxing
+import Lean.Compiler.IR.StackAlloc
+import Lean.Compiler.IR.ThreadLocal
+import Lean.Compiler.IR.Profile
 
 namespace Lean.IR.EmitC
 open ExplicitBoxing (requiresBoxedVersion mkBoxedName isBoxedName)
 
 def leanMainFn := "_lean_main"
 
+/--
+Value of a constant that is laid out as static C data instead of being computed by an `_init_` function when the
+module is initialized.
+-/
+inductive StaticVal where
+  | box    (n : Nat)
+  | ref    (n : Name)
+  | ctor   (cidx : Nat) (fields : Array StaticVal)
+  | string (s : String)
+  | array  (elems : Array StaticVal)
+  deriving Inhabited
+
 structure Context where
   env        : Environment
   modName    : Name
   jpMap      : JPParamsMap := {}
   mainFn     : FunId := default
   mainParams : Array Param := #[]
+  /-- If `true`, the module is emitted as several translation units (see `emitCShards`). -/
+  sharded    : Bool := false
+  /-- Groups of mutually tail-recursive functions of the module, see `mkTailGroups`. -/
+  tailGroups : NameMap (Array Decl) := {}
+  /-- The group of the merged function being emitted, if any. -/
+  tailGroup  : Array Decl := #[]
+  /-- Prefix of the labels of the function body being emitted. -/
+  labelPrefix : String := ""
+  /-- Constructor objects of the function being emitted that are allocated on the stack, see `StackAlloc`. -/
+  stackCtors : StackAlloc.StackCtorMap := {}
+  /-- Number of object fields of the cells reset in the function being emitted, see `emitReuse`. -/
+  resetSizes : Std.HashMap VarId Nat := {}
+  /-- Variables of the current basic block that are statically known to be single threaded, see `ThreadLocal`. -/
+  stVars     : IndexSet := {}
+  /-- If `true`, emit counters for profile-guided optimization, see `Profile`. -/
+  profileInstrument : Bool := false
+  /-- Profile used for code generation, see `Profile`. -/
+  profileData : Profile.ProfileData := {}
+  /-- C name of the function whose counters are used for the code being emitted. -/
+  profFn     : String := ""
+  /-- `true` if `profileData` has a counter for each `case` alternative of `profFn`. Otherwise, the profile was
+  collected from code with different alternatives, e.g., because the inliner used the profile, and its branch
+  counts are ignored. -/
+  profMatches : Bool := false
+  /-- Values of the module's constants that are emitted as static data, see `mkStaticConsts`. -/
+  staticConsts : NameMap StaticVal := {}
 
 abbrev M := ReaderT Context (EStateM String String)
 
@@ -90,11 +132,101 @@ def toCInitName (n : Name) : M String := do
 def emitCInitName (n : Name) : M Unit :=
   toCInitName n >>= emit
 
+def toCStaticName (n : Name) : M String :=
+  return "_static_" ++ (← toCName n)
+
+/-! Statically initialized constants -/
+
+def StaticVal.isObject : StaticVal → Bool
+  | .box _ | .ref _ => false
+  | _               => true
+
+partial def StaticVal.collectRefs : StaticVal → Array Name → Array Name
+  | .ref n,       ns => ns.push n
+  | .ctor _ vs,   ns => vs.foldl (fun ns v => v.collectRefs ns) ns
+  | .array vs,    ns => vs.foldl (fun ns v => v.collectRefs ns) ns
+  | _,            ns => ns
+
+abbrev StaticVals := Std.HashMap VarId StaticVal
+
+def getStaticArg? (vals : StaticVals) : Arg → Option StaticVal
+  | .var x      => vals.find? x
+  | .irrelevant => some (.box 0)
+
+/--
+Return the value of the nullary declaration `d` of the current module if it is statically known, i.e., its body only
+builds constructor objects without scalar fields, string literals, small natural numbers, literal arrays
+(`Array.mkEmpty` followed by `Array.push`es), and static constants of the module in `consts`.
+-/
+def evalStaticExpr (consts : NameMap StaticVal) (vals : StaticVals) : Expr → Option StaticVal
+  | .ctor c ys => do
+    if c.size == 0 && c.usize == 0 && c.ssize == 0 then
+      some (.box c.cidx)
+    -- `LeanMaxCtorTag`
+    else if c.usize == 0 && c.ssize == 0 && c.cidx ≤ 244 then
+      return .ctor c.cidx (← ys.mapM (getStaticArg? vals))
+    else
+      none
+  | .lit (.str s) => some (.string s)
+  -- small enough to be boxed on 32-bit platforms as well
+  | .lit (.num v) => if v < 2^31 then some (.box v) else none
+  | .fap f ys =>
+    if f == ``Array.mkEmpty && ys.size == 2 then
+      some (.array #[])
+    else if f == ``Array.push && ys.size == 3 then do
+      let .array vs ← getStaticArg? vals ys[1]! | none
+      return .array (vs.push (← getStaticArg? vals ys[2]!))
+    else if ys.isEmpty then do
+      let v ← consts.find? f
+      return if v.isObject then .ref f else v
+    else
+      none
+  | _ => none
+
+@[inherit_doc evalStaticExpr]
+partial def evalStatic (consts : NameMap StaticVal) (vals : StaticVals) : FnBody → Option StaticVal
+  | .vdecl x t e b   => do
+    guard t.isObj
+    evalStatic consts (vals.insert x (← evalStaticExpr consts vals e)) b
+  -- reference counting operations are no-ops on static objects
+  | .inc _ _ _ _ b   => evalStatic consts vals b
+  | .dec _ _ _ _ b   => evalStatic consts vals b
+  | .mdata _ b       => evalStatic consts vals b
+  | .ret (.var x)    => vals.find? x
+  | _                => none
+
+@[inherit_doc evalStaticExpr]
+def getStaticVal? (env : Environment) (consts : NameMap StaticVal) : Decl → Option StaticVal
+  | .fdecl (f := f) (xs := xs) (type := t) (body := b) .. => do
+    guard (xs.isEmpty && t.isObj && !hasInitAttr env f)
+    evalStatic consts {} b
+  | _ => none
+
+/--
+Compute the values of all static constants of the module. Declarations are visited in the order they were added, which
+is also the order they are initialized in, so a constant can only refer to constants visited before it.
+-/
+def mkStaticConsts (env : Environment) : NameMap StaticVal :=
+  (getDecls env).foldr (init := {}) fun d consts =>
+    match getStaticVal? env consts d with
+    | some v => consts.insert d.name v
+    | none   => consts
+
+def getStaticConst? (n : Name) : M (Option StaticVal) :=
+  return (← read).staticConsts.find? n
+
+def isStaticConst (n : Name) : M Bool :=
+  return (← read).staticConsts.contains n
+
 def emitFnDeclAux (decl : Decl) (cppBaseName : String) (isExternal : Bool) : M Unit := do
   let ps := decl.params
   let env ← getEnv
   if ps.isEmpty then
-    if isClosedTermName env decl.name then emit "static "
+    if (← read).sharded then
+      -- the variables of the module are defined by `emitConstDefs` in the main translation unit
+      emit "extern "
+      unless isExternal || isClosedTermName env decl.name do emit "LEAN_EXPORT "
+    else if isClosedTermName env decl.name then emit "static "
     else if isExternal then emit "extern "
     else emit "LEAN_EXPORT "
   else
@@ -253,13 +385,36 @@ def declareVar (x : VarId) (t : IRType) : M Unit := do
 def declareParams (ps : Array Param) : M Unit :=
   ps.forM fun p => declareVar p.x p.ty
 
+/-- Return true iff `b` is a tail call to another member of the merged function being emitted. -/
+def isMutualTailCall (ctx : Context) (b : FnBody) : Bool :=
+  match b with
+  | .vdecl _ _ (.fap f _) _ => f != ctx.mainFn && ctx.tailGroup.any (·.name == f) && isTailCallTo f b
+  | _                       => false
+
+def emitCtorScalarSize (usize : Nat) (ssize : Nat) : M Unit := do
+  if usize == 0 then emit ssize
+  else if ssize == 0 then emit "sizeof(size_t)*"; emit usize
+  else emit "sizeof(size_t)*"; emit usize; emit " + "; emit ssize
+
+/-- Name of the C buffer storing the stack allocated object of `x`. -/
+def toStackCtorBufferName (x : VarId) : String :=
+  toString x ++ "_buf"
+
+def declareStackCtorBuffer (x : VarId) (c : CtorInfo) : M Unit := do
+  emit "uint64_t "; emit (toStackCtorBufferName x); emit "[("
+  emit "sizeof(lean_ctor_object) + sizeof(void*)*"; emit c.size; emit " + "; emitCtorScalarSize c.usize c.ssize
+  emit " + 7)/8]; "
+
 partial def declareVars : FnBody → Bool → M Bool
   | e@(FnBody.vdecl x t _ b), d => do
     let ctx ← read
-    if isTailCallTo ctx.mainFn e then
+    if isTailCallTo ctx.mainFn e || isMutualTailCall ctx e then
       pure d
     else
-      declareVar x t; declareVars b true
+      declareVar x t
+      if let some c := ctx.stackCtors.find? x then
+        declareStackCtorBuffer x c
+      declareVars b true
   | FnBody.jdecl _ xs _ b,    d => do declareParams xs; declareVars b (d || xs.size > 0)
   | e,                        d => if e.isTerminal then pure d else declareVars e.body d
 
@@ -275,15 +430,46 @@ def isIf (alts : Array Alt) : Option (Nat × FnBody × FnBody) :=
     | Alt.ctor c b => some (c.cidx, b, alts[1]!.body)
     | _            => none
 
+def profileEnabled : M Bool := do
+  let ctx ← read
+  return ctx.profileInstrument || !ctx.profileData.isEmpty
+
+def emitProfileCounter (fn : String) (i : Nat) : M Unit := do
+  if (← read).profileInstrument then
+    emit "_lean_prof_"; emit fn; emit "["; emit i; emitLn "]++;"
+
+def emitProfileCountersDecl (fn : String) (numCounters : Nat) : M Unit := do
+  if (← read).profileInstrument then
+    emit "static _Atomic(uint64_t) _lean_prof_"; emit fn; emit "["; emit numCounters; emitLn "];"
+
+/-- Return the `LEAN_LIKELY`/`LEAN_UNLIKELY` hint for a branch between `t` and `e`, if the profile shows a bias. -/
+def getBranchHint (t e : FnBody) : M (Option String) := do
+  let ctx ← read
+  unless ctx.profMatches do return none
+  let some i := Profile.getCounter? t | return none
+  let some j := Profile.getCounter? e | return none
+  let some ct := ctx.profileData.get? ctx.profFn i | return none
+  let some ce := ctx.profileData.get? ctx.profFn j | return none
+  if ct > Profile.branchBias * ce then return some "LEAN_LIKELY"
+  else if ce > Profile.branchBias * ct then return some "LEAN_UNLIKELY"
+  else return none
+
 def emitInc (x : VarId) (n : Nat) (checkRef : Bool) : M Unit := do
   emit $
-    if checkRef then (if n == 1 then "lean_inc" else "lean_inc_n")
+    if (← read).stVars.contains x.idx then (if n == 1 then "lean_inc_ref_st" else "lean_inc_ref_n_st")
+    else if checkRef then (if n == 1 then "lean_inc" else "lean_inc_n")
     else (if n == 1 then "lean_inc_ref" else "lean_inc_ref_n")
   emit "("; emit x
   if n != 1 then emit ", "; emit n
   emitLn ");"
 
 def emitDec (x : VarId) (n : Nat) (checkRef : Bool) : M Unit := do
+  if (← read).stackCtors.contains x then
+    emit "lean_free_stack_ctor("; emit x; emitLn ");"
+    return
+  if n == 1 && (← read).stVars.contains x.idx then
+    emit "lean_dec_ref_st("; emit x; emitLn ");"
+    return
   emit (if checkRef then "lean_dec" else "lean_dec_ref");
   emit "("; emit x;
   if n != 1 then emit ", "; emit n
@@ -325,7 +511,7 @@ def emitJmp (j : JoinPointId) (xs : Array Arg) : M Unit := do
     let p := ps[i]!
     let x := xs[i]!
     emit p.x; emit " = "; emitArg x; emitLn ";"
-  emit "goto "; emit j; emitLn ";"
+  emit "goto "; emit (← read).labelPrefix; emit j; emitLn ";"
 
 def emitLhs (z : VarId) : M Unit := do
   emit z; emit " = "
@@ -335,11 +521,6 @@ def emitArgs (ys : Array Arg) : M Unit :=
     if i > 0 then emit ", "
     emitArg ys[i]!
 
-def emitCtorScalarSize (usize : Nat) (ssize : Nat) : M Unit := do
-  if usize == 0 then emit ssize
-  else if ssize == 0 then emit "sizeof(size_t)*"; emit usize
-  else emit "sizeof(size_t)*"; emit usize; emit " + "; emit ssize
-
 def emitAllocCtor (c : CtorInfo) : M Unit := do
   emit "lean_alloc_ctor("; emit c.cidx; emit ", "; emit c.size; emit ", "
   emitCtorScalarSize c.usize c.ssize; emitLn ");"
@@ -348,10 +529,16 @@ def emitCtorSetArgs (z : VarId) (ys : Array Arg) : M Unit :=
   ys.size.forM fun i => do
     emit "lean_ctor_set("; emit z; emit ", "; emit i; emit ", "; emitArg ys[i]!; emitLn ");"
 
+def emitAllocStackCtor (z : VarId) (c : CtorInfo) : M Unit := do
+  emit "lean_alloc_stack_ctor("; emit (toStackCtorBufferName z); emit ", "; emit c.cidx; emit ", "; emit c.size; emit ", "
+  emitCtorScalarSize c.usize c.ssize; emitLn ");"
+
 def emitCtor (z : VarId) (c : CtorInfo) (ys : Array Arg) : M Unit := do
   emitLhs z;
   if c.size == 0 && c.usize == 0 && c.ssize == 0 then do
     emit "lean_box("; emit c.cidx; emitLn ");"
+  else if (← read).stackCtors.contains z then
+    emitAllocStackCtor z c; emitCtorSetArgs z ys
   else do
     emitAllocCtor c; emitCtorSetArgs z ys
 
@@ -365,12 +552,24 @@ def emitReset (z : VarId) (n : Nat) (x : VarId) : M Unit := do
   emit " "; emitLhs z; emitLn "lean_box(0);";
   emitLn "}"
 
+/-- Collect the number of object fields of the cells reset in `b`, see `Context.resetSizes`. -/
+partial def collectResetSizes : FnBody → Std.HashMap VarId Nat → Std.HashMap VarId Nat
+  | .vdecl x _ (.reset n _) b, m => collectResetSizes b (m.insert x n)
+  | .jdecl _ _ v b, m            => collectResetSizes b (collectResetSizes v m)
+  | .case _ _ _ alts, m          => alts.foldl (fun m alt => collectResetSizes alt.body m) m
+  | b, m                         => if b.isTerminal then m else collectResetSizes b.body m
+
 def emitReuse (z : VarId) (x : VarId) (c : CtorInfo) (updtHeader : Bool) (ys : Array Arg) : M Unit := do
   emit "if (lean_is_scalar("; emit x; emitLn ")) {";
   emit " "; emitLhs z; emitAllocCtor c;
   emitLn "} else {";
   emit " "; emitLhs z; emit x; emitLn ";";
-  if updtHeader then emit " lean_ctor_set_tag("; emit z; emit ", "; emit c.cidx; emitLn ");"
+  if updtHeader then
+    if (← read).resetSizes.find? x == some c.size then
+      emit " lean_ctor_set_tag("; emit z; emit ", "; emit c.cidx; emitLn ");"
+    else
+      -- the cell comes from a constructor with a different number of fields, see `compiler.reuseSizeClass`
+      emit " lean_ctor_reuse_set_header("; emit z; emit ", "; emit c.cidx; emit ", "; emit c.size; emitLn ");"
   emitLn "}";
   emitCtorSetArgs z ys
 
@@ -574,13 +773,35 @@ def emitTailCall (v : Expr) : M Unit :=
         let p := ps[i]!
         let y := ys[i]!
         unless paramEqArg p y do emit p.x; emit " = "; emitArg y; emitLn ";"
-    emitLn "goto _start;"
+    emit "goto "; emit ctx.labelPrefix; emitLn "_start;"
   | _ => throw "bug at emitTailCall"
 
+def tailGroupParam (i j : Nat) : String :=
+  "_mt" ++ toString i ++ "_" ++ toString j
+
+/--
+Emit a tail call to another member of the merged function: assign the parameters of the merged function that belong
+to the callee and jump to its entry. The arguments are variables of the caller, so they cannot be overwritten by these
+assignments.
+-/
+def emitMutualTailCall (v : Expr) : M Unit :=
+  match v with
+  | Expr.fap f ys => do
+    let ctx ← read
+    let some i := ctx.tailGroup.findIdx? (·.name == f) | throw "bug at emitMutualTailCall"
+    let ps := ctx.tailGroup[i]!.params
+    unless ps.size == ys.size do throw "invalid tail call"
+    ys.size.forM fun j => do
+      emit (tailGroupParam i j); emit " = "; emitArg ys[j]!; emitLn ";"
+    emit "goto _mt"; emit i; emitLn "_entry;"
+  | _ => throw "bug at emitMutualTailCall"
+
 mutual
 
 partial def emitIf (x : VarId) (xType : IRType) (tag : Nat) (t : FnBody) (e : FnBody) : M Unit := do
-  emit "if ("; emitTag x xType; emit " == "; emit tag; emitLn ")";
+  match (← getBranchHint t e) with
+  | some hint => emit "if ("; emit hint; emit "("; emitTag x xType; emit " == "; emit tag; emitLn "))";
+  | none      => emit "if ("; emitTag x xType; emit " == "; emit tag; emitLn ")";
   emitFnBody t;
   emitLn "else";
   emitFnBody e
@@ -604,9 +825,12 @@ partial def emitBlock (b : FnBody) : M Unit := do
     let ctx ← read
     if isTailCallTo ctx.mainFn d then
       emitTailCall v
+    else if isMutualTailCall ctx d then
+      emitMutualTailCall v
     else
       emitVDecl x t v
-      emitBlock b
+      withReader (fun ctx => { ctx with stVars := ThreadLocal.updateVDecl ctx.stVars x v }) do
+        emitBlock b
   | FnBody.inc x n c p b       =>
     unless p do emitInc x n c
     emitBlock b
@@ -615,17 +839,29 @@ partial def emitBlock (b : FnBody) : M Unit := do
     emitBlock b
   | FnBody.del x b             => emitDel x; emitBlock b
   | FnBody.setTag x i b        => emitSetTag x i; emitBlock b
-  | FnBody.set x i y b         => emitSet x i y; emitBlock b
+  | FnBody.set x i y b         =>
+    emitSet x i y
+    let stVars := match y with
+      | .var y      => (← read).stVars.erase y.idx
+      | .irrelevant => (← read).stVars
+    withReader (fun ctx => { ctx with stVars }) do
+      emitBlock b
   | FnBody.uset x i y b        => emitUSet x i y; emitBlock b
   | FnBody.sset x i o y t b    => emitSSet x i o y t; emitBlock b
-  | FnBody.mdata _ b           => emitBlock b
+  | e@(FnBody.mdata _ b)       =>
+    if let some i := Profile.getCounter? e then emitProfileCounter (← read).profFn i
+    emitBlock b
   | FnBody.ret x               => emit "return "; emitArg x; emitLn ";"
   | FnBody.case _ x xType alts => emitCase x xType alts
   | FnBody.jmp j xs            => emitJmp j xs
   | FnBody.unreachable         => emitLn "lean_internal_panic_unreachable();"
 
 partial def emitJPs : FnBody → M Unit
-  | FnBody.jdecl j _  v b => do emit j; emitLn ":"; emitFnBody v; emitJPs b
+  | FnBody.jdecl j _  v b => do
+    emit (← read).labelPrefix; emit j; emitLn ":"
+    -- the join point may be reached after the variables in scope escape
+    withReader (fun ctx => { ctx with stVars := {} }) (emitFnBody v)
+    emitJPs b
   | e                     => do unless e.isTerminal do emitJPs e.body
 
 partial def emitFnBody (b : FnBody) : M Unit := do
@@ -640,14 +876,21 @@ end
 
 def emitDeclAux (d : Decl) : M Unit := do
   let env ← getEnv
+  let (d, numCounters) := if (← profileEnabled) then Profile.annotateDecl d else (d, 0)
   let (_, jpMap) := mkVarJPMaps d
-  withReader (fun ctx => { ctx with jpMap := jpMap }) do
-  unless hasInitAttr env d.name do
+  let resetSizes := match d with
+    | .fdecl (body := b) .. => collectResetSizes b {}
+    | _ => {}
+  withReader (fun ctx => { ctx with jpMap := jpMap, stackCtors := d.collectStackCtors, resetSizes }) do
+  unless hasInitAttr env d.name || (← isStaticConst d.name) do
     match d with
     | .fdecl (f := f) (xs := xs) (type := t) (body := b) .. =>
       let baseName ← toCName f;
+      emitProfileCountersDecl baseName numCounters
+      if (← read).profileData.get? baseName 0 == some 0 then emit "LEAN_COLD "
       if xs.size == 0 then
-        emit "static "
+        -- initializers of sharded modules are called from the main translation unit
+        unless (← read).sharded do emit "static "
       else
         emit "LEAN_EXPORT "  -- make symbol visible to the interpreter
       emit (toCType t); emit " ";
@@ -669,22 +912,198 @@ def emitDeclAux (d : Decl) : M Unit := do
         xs.size.forM fun i => do
           let x := xs[i]!
           emit "lean_object* "; emit x.x; emit " = _args["; emit i; emitLn "];"
+      emitProfileCounter baseName 0
       emitLn "_start:";
-      withReader (fun ctx => { ctx with mainFn := f, mainParams := xs }) (emitFnBody b);
+      let profMatches := (← read).profileData.matches baseName numCounters
+      withReader (fun ctx => { ctx with mainFn := f, mainParams := xs, profFn := baseName, profMatches }) (emitFnBody b);
       emitLn "}"
     | _ => pure ()
 
+/-! Mutual tail calls
+
+The C compiler is not required to turn tail calls into jumps, so mutually tail-recursive functions could exhaust the
+stack, e.g. at `-O0`. We merge each group of such functions into a single static C function taking the parameters of
+all members and a member index, in which tail calls between members are jumps. The members themselves become
+wrappers calling the merged function. -/
+
+/-- Collect the functions called in tail position in `b`. -/
+partial def collectTailCalls (b : FnBody) (fs : NameSet) : NameSet :=
+  match b with
+  | .vdecl _ _ (.fap f _) c => if isTailCallTo f b then fs.insert f else collectTailCalls c fs
+  | .jdecl _ _ v c          => collectTailCalls c (collectTailCalls v fs)
+  | .case _ _ _ alts        => alts.foldl (fun fs alt => collectTailCalls alt.body fs) fs
+  | e                       => if e.isTerminal then fs else collectTailCalls e.body fs
+
+/-- Upper bound on the number of parameters of a merged function. -/
+def maxTailGroupParams := 64
+
+/--
+Return the groups of mutually tail-recursive functions of the module, i.e., the nontrivial strongly connected
+components of the graph of tail calls, with their members in emission order.
+-/
+def mkTailGroups (env : Environment) : NameMap (Array Decl) := Id.run do
+  let decls := (getDecls env).reverse.filter fun d =>
+    d matches .fdecl .. && !d.params.isEmpty && d.params.size ≤ closureMaxArgs && !isBoxedName d.name &&
+    !hasInitAttr env d.name
+  let declMap : NameMap Decl := decls.foldl (fun m d => m.insert d.name d) {}
+  let successorsOf (n : Name) : List Name :=
+    match declMap.find? n with
+    | some (.fdecl (body := b) ..) => (collectTailCalls b {}).toList.filter fun f => f != n && declMap.contains f
+    | _                           => []
+  let mut groups := {}
+  for scc in SCC.scc (decls.map (·.name)) successorsOf do
+    if scc.length > 1 then
+      let group := decls.toArray.filter (scc.contains ·.name)
+      -- members tail-calling each other have the same result type
+      if group.all (·.resultType == group[0]!.resultType) &&
+         group.foldl (fun n d => n + d.params.size) 0 ≤ maxTailGroupParams then
+        for d in group do
+          groups := groups.insert d.name group
+  return groups
+
+def toCTailGroupName (group : Array Decl) : M String :=
+  return "_mtail_" ++ (← toCName group[0]!.name)
+
+def emitTailGroupFn (group : Array Decl) : M Unit := do
+  let group := group.map (·.normalizeIds)
+  let annotated := if (← profileEnabled) then group.map Profile.annotateDecl else group.map fun d => (d, 0)
+  if (← read).profileInstrument then
+    annotated.forM fun (d, numCounters) => do emitProfileCountersDecl (← toCName d.name) numCounters
+  let group := annotated.map (·.1)
+  emit "static "; emit (toCType group[0]!.resultType); emit " "; emit (← toCTailGroupName group); emit "(unsigned _fn"
+  group.size.forM fun i => do
+    let ps := group[i]!.params
+    ps.size.forM fun j => do
+      emit ", "; emit (toCType ps[j]!.ty); emit " "; emit (tailGroupParam i j)
+  emitLn ") {"
+  emitLn "switch (_fn) {"
+  group.size.forM fun i => do
+    emit "case "; emit i; emit ": goto _mt"; emit i; emitLn "_entry;"
+  emitLn "}"
+  group.size.forM fun i => do
+    let d := group[i]!
+    match d with
+    | .fdecl (f := f) (xs := xs) (body := b) .. =>
+      let (_, jpMap) := mkVarJPMaps d
+      emit "_mt"; emit i; emitLn "_entry: {"
+      xs.size.forM fun j => do
+        emit (toCType xs[j]!.ty); emit " "; emit xs[j]!.x; emit " = "; emit (tailGroupParam i j); emitLn ";"
+      let profFn ← toCName f
+      let profMatches := (← read).profileData.matches profFn annotated[i]!.2
+      emitProfileCounter profFn 0
+      let labelPrefix := "_mt" ++ toString i
+      emit labelPrefix; emitLn "_start:"
+      withReader (fun ctx => { ctx with jpMap := jpMap, mainFn := f, mainParams := xs, tailGroup := group,
+                                       labelPrefix := labelPrefix, stackCtors := d.collectStackCtors, profFn, profMatches,
+                                       resetSizes := collectResetSizes b {} })
+        (emitFnBody b)
+      emitLn "}"
+    | _ => pure ()
+  emitLn "}"
+
+def emitTailGroupWrapper (group : Array Decl) (d : Decl) : M Unit := do
+  let some i := group.findIdx? (·.name == d.name) | throw "bug at emitTailGroupWrapper"
+  let xs := d.params
+  emit "LEAN_EXPORT "; emit (toCType d.resultType); emit " "; emitCName d.name; emit "("
+  xs.size.forM fun j => do
+    if j > 0 then emit ", "
+    emit (toCType xs[j]!.ty); emit " "; emit xs[j]!.x
+  emitLn ") {"
+  emit "return "; emit (← toCTailGroupName group); emit "("; emit i
+  group.size.forM fun k => do
+    group[k]!.params.size.forM fun j => do
+      emit ", "
+      if k == i then emit xs[j]!.x else emit "0"
+  emitLn ");"
+  emitLn "}"
+
 def emitDecl (d : Decl) : M Unit := do
   let d := d.normalizeIds; -- ensure we don't have gaps in the variable indices
   try
-    emitDeclAux d
+    match (← read).tailGroups.find? d.name with
+    | some group =>
+      if group[0]!.name == d.name then emitTailGroupFn group
+      emitTailGroupWrapper group d
+    | none => emitDeclAux d
   catch err =>
     throw s!"{err}\ncompiling:\n{d}"
 
 def emitFns : M Unit := do
   let env ← getEnv;
   let decls := getDecls env;
-  decls.reverse.forM emitDecl
+  withReader (fun ctx => { ctx with tailGroups := mkTailGroups env }) do
+    decls.reverse.forM emitDecl
+
+def boxedScalarToCString (n : Nat) : String :=
+  "((lean_object*)(size_t)" ++ toString (2*n + 1) ++ ")"
+
+/-- Return a C constant expression for `v`, where `n` is the constant with value `v`. -/
+def toStaticExpr (n : Name) (v : StaticVal) : M String :=
+  match v with
+  | .box k => pure (boxedScalarToCString k)
+  | .ref g => return "((lean_object*)&" ++ (← toCStaticName g) ++ ")"
+  | _      => return "((lean_object*)&" ++ (← toCStaticName n) ++ ")"
+
+def staticHeaderToCString (size other tag : String) : String :=
+  "{0, " ++ size ++ ", " ++ other ++ ", " ++ tag ++ "}"
+
+mutual
+
+/-- Emit the objects of `v` that are not emitted inline, naming them `<base>_<i>`, and return a C expression for `v`. -/
+partial def emitStaticVal (base : String) (v : StaticVal) : StateT Nat M String :=
+  match v with
+  | .box k => pure (boxedScalarToCString k)
+  | .ref g => return "((lean_object*)&" ++ (← toCStaticName g) ++ ")"
+  | _      => do
+    let name := base ++ "_" ++ toString (← modifyGet fun i => (i, i+1))
+    emitStaticObj base name v
+    return "((lean_object*)&" ++ name ++ ")"
+
+/-- Emit the static object `name` with value `v`. Objects have the `m_rc == 0` header of persistent objects. -/
+partial def emitStaticObj (base : String) (name : String) (v : StaticVal) : StateT Nat M Unit :=
+  match v with
+  | .ctor cidx vs => do
+    let fs ← vs.mapM (emitStaticVal base)
+    emitLn ("static const struct { lean_object m_header; lean_object* m_objs[" ++ toString fs.size ++ "]; } " ++ name ++ " = {" ++
+      staticHeaderToCString ("sizeof(lean_ctor_object) + sizeof(void*)*" ++ toString fs.size) (toString fs.size) (toString cidx) ++
+      ", {" ++ ", ".intercalate fs.toList ++ "}};")
+  | .string s => do
+    let size := toString (s.utf8ByteSize + 1)
+    emitLn ("static const struct { lean_object m_header; size_t m_size; size_t m_capacity; size_t m_length; char m_data[" ++ size ++ "]; } " ++
+      name ++ " = {" ++ staticHeaderToCString "1" "0" "LeanString" ++ ", " ++ size ++ ", " ++ size ++ ", " ++ toString s.length ++ ", " ++
+      quoteString s ++ "};")
+  | .array vs => do
+    let es ← vs.mapM (emitStaticVal base)
+    let size := toString es.size
+    if es.isEmpty then
+      emitLn ("static const struct { lean_object m_header; size_t m_size; size_t m_capacity; } " ++ name ++ " = {" ++
+        staticHeaderToCString "1" "0" "LeanArray" ++ ", 0, 0};")
+    else
+      emitLn ("static const struct { lean_object m_header; size_t m_size; size_t m_capacity; lean_object* m_data[" ++ size ++ "]; } " ++
+        name ++ " = {" ++ staticHeaderToCString "1" "0" "LeanArray" ++ ", " ++ size ++ ", " ++ size ++ ", {" ++ ", ".intercalate es.toList ++ "}};")
+  | _ => pure ()
+
+end
+
+/-- Emit the static data of `n` after the data of the constants it references. -/
+partial def emitStaticConst (n : Name) (v : StaticVal) : StateT NameSet M Unit := do
+  unless (← get).contains n do
+    modify (·.insert n)
+    for g in v.collectRefs #[] do
+      if let some w ← getStaticConst? g then
+        emitStaticConst g w
+    if v.isObject then
+      let name ← toCStaticName n
+      discard <| (emitStaticObj name name v).run 0
+
+def emitStaticConsts : M Unit := do
+  let env ← getEnv
+  let go : StateT NameSet M Unit :=
+    (getDecls env).reverse.forM fun d => do
+      if d.params.isEmpty then
+        if let some v ← getStaticConst? d.name then
+          emitStaticConst d.name v
+  discard <| go.run {}
 
 def emitMarkPersistent (d : Decl) (n : Name) : M Unit := do
   if d.resultType.isObj then
@@ -712,7 +1131,10 @@ def emitDeclInit (d : Decl) : M Unit := do
       if getBuiltinInitFnNameFor? env d.name |>.isSome then
         emit "}"
     | _ =>
-      emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
+      if let some v ← getStaticConst? n then
+        emitCName n; emit " = "; emit (← toStaticExpr n v); emitLn ";"
+      else
+        emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
 
 def emitInitFn : M Unit := do
   let env ← getEnv
@@ -733,20 +1155,144 @@ def emitInitFn : M Unit := do
   decls.reverse.forM emitDeclInit
   emitLns ["return lean_io_result_mk_ok(lean_box(0));", "}"]
 
+/-- Register the counters of the functions `decls` emitted in the current translation unit, see `Profile`. -/
+def emitProfileTable (decls : Array Decl) : M Unit := do
+  unless (← read).profileInstrument do return
+  let env ← getEnv
+  let consts := (← read).staticConsts
+  let decls := decls.filter fun d => d matches .fdecl .. && !hasInitAttr env d.name && !consts.contains d.name
+  if decls.isEmpty then return
+  emitLn "static lean_prof_entry _lean_prof_entries[] = {"
+  decls.forM fun d => do
+    let cName ← toCName d.name
+    emitLn ("{" ++ quoteString cName ++ ", _lean_prof_" ++ cName ++ ", " ++ toString (Profile.annotateDecl d).2 ++ "},")
+  emitLn "};"
+  emitLn ("static lean_prof_module _lean_prof_module = {_lean_prof_entries, " ++ toString decls.size ++ ", NULL};")
+  emitLns ["#ifndef LEAN_CONSTRUCTOR",
+           "#error \"code compiled with --profile-instrument requires a C compiler supporting __attribute__((constructor))\"",
+           "#endif"]
+  emitLn "LEAN_CONSTRUCTOR static void _lean_prof_init(void) { lean_prof_register(&_lean_prof_module); }"
+
 def main : M Unit := do
   emitFileHeader
   emitFnDecls
   emitFns
+  emitProfileTable (getDecls (← getEnv))
+  emitStaticConsts
   emitInitFn
   emitMainFnIfNeeded
   emitFileFooter
 
+/-! Sharded output, see `emitCShards`. -/
+
+/--
+Assign each function definition of the module to one of `numShards` shards. Strongly connected components of the
+call graph stay together, and the shard of a component only depends on the names of its members, so that changing
+a function only changes the translation unit containing it.
+-/
+def mkShardMap (env : Environment) (numShards : Nat) : NameMap Nat := Id.run do
+  let decls := getDecls env
+  let modDecls : NameSet := decls.foldl (fun s d => s.insert d.name) {}
+  let successorsOf (n : Name) : List Name :=
+    match findEnvDecl env n with
+    | some d => (collectUsedDecls env d).toList.filter modDecls.contains
+    | none   => []
+  let mut shardOf := {}
+  for scc in SCC.scc (decls.map (·.name)) successorsOf do
+    let h := scc.foldl (fun h n => min h (hash n)) (hash scc.head!)
+    let i := (h % numShards.toUInt64).toNat
+    for n in scc do
+      shardOf := shardOf.insert n i
+  return shardOf
+
+def emitInitFnDecls : M Unit := do
+  let env ← getEnv
+  (getDecls env).reverse.forM fun d => do
+    match d with
+    | .fdecl (f := f) (xs := xs) (type := t) .. =>
+      if xs.isEmpty && !hasInitAttr env f && !(← isStaticConst f) then
+        emitLn (toCType t ++ " " ++ (← toCInitName f) ++ "();")
+    | _ => pure ()
+
+def emitConstDef (d : Decl) (cName : String) : M Unit := do
+  unless isClosedTermName (← getEnv) d.name do emit "LEAN_EXPORT "
+  emitLn (toCType d.resultType ++ " " ++ cName ++ ";")
+
+/-- Define the variables of the module's constants, which are only declared `extern` in the shared header. -/
+def emitConstDefs : M Unit := do
+  let env ← getEnv
+  (getDecls env).reverse.forM fun d => do
+    if d.params.isEmpty then
+      match getExternNameFor env `c d.name with
+      | some cName => unless isExternC env d.name do emitConstDef d cName
+      | none       => emitConstDef d (← toCName d.name)
+
+def emitShardPrelude (headerName : String) : M Unit := do
+  emitLn "// Lean compiler output"
+  emitLn ("// Module: " ++ toString (← getModName))
+  emitLn ("#include " ++ quoteString headerName)
+  emitLns [
+    "#ifdef __cplusplus",
+    "extern \"C\" {",
+    "#endif"
+  ]
+
+def emitShardHeader : M Unit := do
+  emitFileHeader
+  emitFnDecls
+  emitInitFnDecls
+  emitFileFooter
+
+def emitShardMain (headerName : String) : M Unit := do
+  emitShardPrelude headerName
+  emitConstDefs
+  emitStaticConsts
+  emitInitFn
+  emitMainFnIfNeeded
+  emitFileFooter
+
+def emitShard (headerName : String) (shardOf : NameMap Nat) (i : Nat) : M Unit := do
+  emitShardPrelude headerName
+  let env ← getEnv
+  withReader (fun ctx => { ctx with tailGroups := mkTailGroups env }) do
+    (getDecls env).reverse.forM fun d => do
+      if shardOf.find? d.name == some i then emitDecl d
+  emitProfileTable ((getDecls env).filter fun d => shardOf.find? d.name == some i)
+  emitFileFooter
+
 end EmitC
 
+/--
+Emit the module as a single C file. If `profileInstrument` is `true`, the code counts function calls and `case`
+alternatives, and `profileData` is the content of a profile file used for code generation, see `Profile`.
+-/
 @[export lean_ir_emit_c]
-def emitC (env : Environment) (modName : Name) : Except String String :=
-  match (EmitC.main { env := env, modName := modName }).run "" with
+def emitC (env : Environment) (modName : Name) (profileInstrument : Bool) (profileData : String) : Except String String :=
+  let profileData := Profile.ProfileData.parse profileData
+  let staticConsts := EmitC.mkStaticConsts env
+  match (EmitC.main { env, modName, profileInstrument, profileData, staticConsts }).run "" with
   | EStateM.Result.ok    _   s => Except.ok s
   | EStateM.Result.error err _ => Except.error err
 
+/--
+Emit the module as `numShards + 2` C files that can be compiled in parallel: a header declaring all functions and
+constants used by the module, a main translation unit defining the constants, the module initializer and `main`,
+and `numShards` translation units with the function definitions (see `EmitC.mkShardMap`). All translation units
+include the header using `headerName`.
+-/
+@[export lean_ir_emit_c_shards]
+def emitCShards (env : Environment) (modName : Name) (headerName : String) (numShards : Nat) (profileInstrument : Bool)
+    (profileData : String) : Except String (Array String) := do
+  let profileData := Profile.ProfileData.parse profileData
+  let staticConsts := EmitC.mkStaticConsts env
+  let run (x : EmitC.M Unit) : Except String String :=
+    match (x { env, modName, sharded := true, profileInstrument, profileData, staticConsts }).run "" with
+    | EStateM.Result.ok    _   s => Except.ok s
+    | EStateM.Result.error err _ => Except.error err
+  let shardOf := EmitC.mkShardMap env numShards
+  let mut files := #[← run EmitC.emitShardHeader, ← run (EmitC.emitShardMain headerName)]
+  for i in [0:numShards] do
+    files := files.push (← run (EmitC.emitShard headerName shardOf i))
+  return files
+
 end Lean.IR
@@ -246,9 +246,17 @@ partial def expand (mainFn : FnBody → Array FnBody → M FnBody)
   let b := FnBody.vdecl c IRType.uint8 (Expr.isShared y) (mkIf c bSlow bFast)
   return reshape bs b
 
+/-- Return true iff `b` contains a `reuse x ctor_i ...` where `ctor_i` does not have `n` fields.
+   The fast path cannot update the number of fields in the header of the cell, see `compiler.reuseSizeClass`. -/
+partial def reusesWithOtherSize (x : VarId) (n : Nat) : FnBody → Bool
+  | FnBody.vdecl _ _ (Expr.reuse y c _ _) b => (x == y && c.size != n) || reusesWithOtherSize x n b
+  | FnBody.jdecl _ _ v b     => reusesWithOtherSize x n v || reusesWithOtherSize x n b
+  | FnBody.case _ _ _ alts   => alts.any fun alt => reusesWithOtherSize x n alt.body
+  | e => if e.isTerminal then false else reusesWithOtherSize x n e.body
+
 partial def searchAndExpand : FnBody → Array FnBody → M FnBody
   | d@(FnBody.vdecl x _ (Expr.reset n y) b), bs =>
-    if consumed x b then do
+    if consumed x b && !reusesWithOtherSize x n b then do
       expand searchAndExpand bs x n y b
     else
       searchAndExpand b (push bs d)
@@ -0,0 +1,89 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Std.Data.HashMap
+import Lean.Compiler.IR.Basic
+
+/-!
+Profile-guided code generation.
+
+When instrumenting (`lean --profile-instrument`), the C emitter creates an array of counters for each function:
+counter `0` counts the calls to the function, and counter `i > 0` counts the executions of the `i`-th alternative
+of a `case` instruction. The runtime writes the counters to the file `$LEAN_PROFILE_FILE` (default:
+`default.leanprof`) at exit, one line `<C function name> <counter> <value>` per counter, appending to existing
+profiles.
+
+When compiling with a profile (`lean --profile-use=file`), the inliner (`csimp.cpp`) also inlines small functions
+that the profile shows to be hot. The C emitter uses `LEAN_LIKELY`/`LEAN_UNLIKELY` for biased two-way branches,
+and marks the functions that were never called as `LEAN_COLD`, which the C compiler optimizes for size and does
+not inline.
+
+`case` alternatives are numbered by `annotateDecl` on the final IR. The branch counts of a function are only used
+if it has the same number of alternatives in both compilations, which is not the case if the profile changed the
+inlining decisions for it. The counter of an alternative is stored in an `mdata` instruction at its beginning. -/
+
+namespace Lean.IR.Profile
+
+def counterKey : Name := `profile.counter
+
+/-- Bias required to emit `LEAN_LIKELY`/`LEAN_UNLIKELY` for a branch. -/
+def branchBias := 8
+
+/-- Counters of each function, indexed by its C name. -/
+abbrev ProfileData := Std.HashMap String (Array Nat)
+
+/-- Return the counter of the alternative starting with `b`, if any. -/
+def getCounter? : FnBody → Option Nat
+  | .mdata d _ => match d.find counterKey with
+    | some (.ofNat i) => some i
+    | _               => none
+  | _ => none
+
+partial def annotateFnBody : FnBody → StateM Nat FnBody
+  | .jdecl j xs v b => return .jdecl j xs (← annotateFnBody v) (← annotateFnBody b)
+  | .case tid x xType alts => do
+    let alts ← alts.mapM fun alt => do
+      let i ← modifyGet fun i => (i, i+1)
+      let b ← annotateFnBody alt.body
+      return alt.modifyBody fun _ => .mdata (MData.empty.setNat counterKey i) b
+    return .case tid x xType alts
+  | e => do
+    if e.isTerminal then return e
+    else
+      let (instr, b) := e.split
+      return instr.setBody (← annotateFnBody b)
+
+/-- Number the `case` alternatives of `d`, and return the result and the number of counters of `d`. -/
+def annotateDecl (d : Decl) : Decl × Nat :=
+  match d with
+  | .fdecl f xs ty b info =>
+    let (b, n) := annotateFnBody b |>.run 1
+    (.fdecl f xs ty b info, n)
+  | other => (other, 0)
+
+/-- Parse a profile written by the runtime. Counters of repeated runs are added. -/
+def ProfileData.parse (s : String) : ProfileData :=
+  s.splitOn "\n" |>.foldl (init := {}) fun data line =>
+    match line.splitOn " " with
+    | [fn, i, n] =>
+      match i.toNat?, n.toNat? with
+      | some i, some n =>
+        let cs := data.findD fn #[]
+        let cs := if cs.size ≤ i then cs ++ mkArray (i + 1 - cs.size) 0 else cs
+        data.insert fn (cs.modify i (· + n))
+      | _, _ => data
+    | _ => data
+
+/-- Return the value of the `i`-th counter of the function `fn`, if it is in the profile. -/
+def ProfileData.get? (data : ProfileData) (fn : String) (i : Nat) : Option Nat := do
+  let cs ← data.find? fn
+  cs[i]?
+
+/-- Return `true` if `data` has exactly `numCounters` counters for the function `fn`. -/
+def ProfileData.matches (data : ProfileData) (fn : String) (numCounters : Nat) : Bool :=
+  match data.find? fn with
+  | some cs => cs.size == numCounters
+  | none    => false
+
+end Lean.IR.Profile
@@ -0,0 +1,82 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Compiler.IR.CompilerM
+import Lean.Compiler.IR.FreeVars
+
+/-!
+Escape analysis for constructor objects.
+
+This analysis runs on the final IR, i.e., after `explicitRC` and `expandResetReuse`, and finds the variables
+`x := ctor_i ys` whose value does not escape the function: `x` is only projected, inspected by `case`, has its
+scalar fields initialized, and is consumed by a single `dec x` on each path. In particular, `x` is not stored in
+other objects, passed to functions or join points, returned, shared (`inc x`), or reused.
+
+The C emitter allocates these objects on the stack instead of the heap. Their reference counter is zero, and
+the final `dec x` releases their fields. -/
+
+namespace Lean.IR.StackAlloc
+
+/-- Mapping from the variables of stack allocated objects to their constructor. -/
+abbrev StackCtorMap := Std.HashMap VarId CtorInfo
+
+/-- Upper bound on the size in bytes of a constructor object allocated on the stack. -/
+def maxStackCtorSize := 256
+
+/--
+Upper bound on the total size in bytes of the constructor objects allocated on the stack by a single function, so that
+functions with many such objects do not blow up the size of their C stack frame.
+-/
+def maxStackCtorsSize := 1024
+
+/-- Size in bytes of an object of constructor `c` on 64-bit platforms. -/
+def ctorObjSize (c : CtorInfo) : Nat :=
+  8 + 8 * (c.size + c.usize) + c.ssize
+
+/-- Return `true` iff the object stored in `x` does not escape `b`, the continuation of its declaration. -/
+partial def isLocal (x : VarId) : FnBody → Bool
+  | .vdecl _ _ v b =>
+    let ok := match v with
+      | .proj _ _ | .uproj _ _ | .sproj _ _ _ => true
+      | v => !v.hasFreeVar x
+    ok && isLocal x b
+  | .jdecl _ _ v b        => isLocal x v && isLocal x b
+  | .set y _ a b          => y != x && !a.hasFreeVar x && isLocal x b
+  | .setTag y _ b         => y != x && isLocal x b
+  | .uset _ _ _ b         => isLocal x b
+  | .sset _ _ _ _ _ b     => isLocal x b
+  | .inc y _ _ _ b        => y != x && isLocal x b
+  | .dec y n _ _ b        => (y != x || n == 1) && isLocal x b
+  | .del y b              => y != x && isLocal x b
+  | .mdata _ b            => isLocal x b
+  | .case _ _ _ alts      => alts.all fun alt => isLocal x alt.body
+  | .ret a                => !a.hasFreeVar x
+  | .jmp _ ys             => ys.all fun y => !y.hasFreeVar x
+  | .unreachable          => true
+
+/--
+Collect the constructor objects of a function body that can be allocated on the stack, together with their total size,
+which is bounded by `maxStackCtorsSize`.
+-/
+partial def collectFnBody : FnBody → StackCtorMap × Nat → StackCtorMap × Nat
+  | .vdecl x _ (.ctor c _) b, s =>
+    let (m, total) := collectFnBody b s
+    let size := ctorObjSize c
+    if c.isRef && size ≤ maxStackCtorSize && total + size ≤ maxStackCtorsSize && isLocal x b then
+      (m.insert x c, total + size)
+    else
+      (m, total)
+  | .jdecl _ _ v b, s    => collectFnBody b (collectFnBody v s)
+  | .case _ _ _ alts, s  => alts.foldl (fun s alt => collectFnBody alt.body s) s
+  | e, s                 => if e.isTerminal then s else collectFnBody e.body s
+
+end StackAlloc
+
+/-- Return the constructor objects of `d` that can be allocated on the stack. See `StackAlloc.isLocal`. -/
+def Decl.collectStackCtors (d : Decl) : StackAlloc.StackCtorMap :=
+  match d with
+  | .fdecl (body := b) .. => (StackAlloc.collectFnBody b ({}, 0)).1
+  | _ => {}
+
+end Lean.IR
@@ -0,0 +1,50 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Compiler.IR.Basic
+
+/-!
+Objects that are statically known to be single threaded.
+
+An object allocated by `x := ctor_i ys`, `x := reuse y in ctor_i ys` or `x := pap f ys` is a single threaded,
+non persistent heap object (`m_rc > 0`). It remains single threaded until it becomes reachable from other code:
+until it is passed to a function or closure, stored in another object, captured by a closure, returned, or passed
+to a join point. Before this point, no other thread can access `x`, and `lean_mark_mt`/`lean_mark_persistent`
+cannot reach it.
+
+The C emitter tracks these variables while emitting a basic block, and uses `lean_inc_ref_st` and
+`lean_dec_ref_st` for them. These functions do not check whether the object is a tagged pointer,
+a multi-threaded object or a persistent object. -/
+
+namespace Lean.IR.ThreadLocal
+
+/-- Return `true` iff `v` always produces a fresh single threaded heap object. -/
+def isFreshObj : Expr → Bool
+  | .ctor c _       => c.isRef
+  | .reuse _ c _ _  => c.isRef
+  | .pap _ _        => true
+  | _               => false
+
+private def eraseArgs (s : IndexSet) (ys : Array Arg) : IndexSet :=
+  ys.foldl (init := s) fun s y =>
+    match y with
+    | .var y      => s.erase y.idx
+    | .irrelevant => s
+
+/-- Remove from `s` the variables that may escape when `v` is evaluated. -/
+def eraseEscaping (s : IndexSet) : Expr → IndexSet
+  | .ctor _ ys       => eraseArgs s ys
+  | .reuse x _ _ ys  => eraseArgs (s.erase x.idx) ys
+  | .reset _ x       => s.erase x.idx
+  | .fap _ ys        => eraseArgs s ys
+  | .pap _ ys        => eraseArgs s ys
+  | .ap x ys         => eraseArgs (s.erase x.idx) ys
+  | _                => s
+
+/-- Update the set of single threaded variables `s` after `x := v`. -/
+def updateVDecl (s : IndexSet) (x : VarId) (v : Expr) : IndexSet :=
+  let s := eraseEscaping s v
+  if isFreshObj v then s.insert x.idx else s
+
+end Lean.IR.ThreadLocal
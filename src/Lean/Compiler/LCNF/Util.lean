@@ -77,6 +77,7 @@ def builtinRuntimeTypes : List Name := [
   ``Float,
   ``Thunk, ``Task,
   ``Array, ``ByteArray, ``FloatArray,
+  ``UInt16Array, ``UInt32Array, ``UInt64Array,
   ``Nat, ``Int
 ]
 
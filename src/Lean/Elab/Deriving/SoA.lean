@@ -0,0 +1,70 @@
+/-
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Elab.Deriving.Basic
+
+/-!
+`deriving SoA` for a structure `S` generates the structure `S.SoA` with a `ScalarArray` column per field of `S`,
+and the instance `SoA S.SoA S`. -/
+
+namespace Lean.Elab.Deriving.SoA
+open Command Meta
+
+/-- Return the `ScalarArray` type used to store the fields of type `type`. -/
+def columnType? (type : Expr) : Option Name :=
+  if type.isConstOf ``UInt8 then some ``ByteArray
+  else if type.isConstOf ``UInt16 then some ``UInt16Array
+  else if type.isConstOf ``UInt32 then some ``UInt32Array
+  else if type.isConstOf ``UInt64 then some ``UInt64Array
+  else if type.isConstOf ``Float then some ``FloatArray
+  else none
+
+def mkSoAInstance (declName : Name) : CommandElabM Unit := do
+  unless isStructure (← getEnv) declName do
+    throwError "'deriving SoA' failed, '{declName}' is not a structure"
+  let indVal ← getConstInfoInduct declName
+  unless indVal.numParams == 0 && indVal.levelParams.isEmpty do
+    throwError "'deriving SoA' failed, '{declName}' must not have parameters"
+  let ctorVal ← getConstInfoCtor indVal.ctors[0]!
+  let fields ← liftTermElabM <| forallTelescopeReducing ctorVal.type fun xs _ => xs.mapM fun x => do
+    let localDecl ← getFVarLocalDecl x
+    let type ← whnfR localDecl.type
+    let some col := columnType? type
+      | throwError "'deriving SoA' failed, field '{localDecl.userName}' of '{declName}' has type{indentExpr localDecl.type}\nbut only UInt8, UInt16, UInt32, UInt64 and Float fields are supported"
+    return (localDecl.userName, col)
+  if fields.isEmpty then
+    throwError "'deriving SoA' failed, '{declName}' has no fields"
+  let fieldIds := fields.map fun (n, _) => mkIdent n
+  let colTypes := fields.map fun (_, col) => mkCIdent col
+  let cs := (List.range fields.size).toArray.map fun i => mkIdent (Name.mkSimple s!"c{i}")
+  let mkEmpties ← colTypes.mapM fun col => `($(col).mkEmpty n)
+  let pushes ← (cs.zip fieldIds).mapM fun (c, fid) => `($(c).push v.$fid)
+  let gets ← cs.mapM fun c => `($(c).get! i)
+  let sets ← (cs.zip fieldIds).mapM fun (c, fid) => `($(c).set! i v.$fid)
+  let declId := mkCIdent declName
+  let soaId := mkIdent (`_root_ ++ declName ++ `SoA)
+  let soaCId := mkCIdent (declName ++ `SoA)
+  elabCommand <| ← withFreshMacroScope `(
+    structure $soaId:ident where
+      $[($fieldIds : $colTypes)]*
+      deriving Inhabited
+
+    instance : SoA $soaCId $declId where
+      mkEmpty n := ⟨$[$mkEmpties],*⟩
+      size a := a.1.size
+      push | ⟨$[$cs],*⟩, v => ⟨$[$pushes],*⟩
+      get! | ⟨$[$cs],*⟩, i => ⟨$[$gets],*⟩
+      set! | ⟨$[$cs],*⟩, i, v => ⟨$[$sets],*⟩
+  )
+
+def mkSoAInstanceHandler (declNames : Array Name) : CommandElabM Bool := do
+  if declNames.size != 1 then
+    return false
+  mkSoAInstance declNames[0]!
+  return true
+
+builtin_initialize
+  registerDerivingHandler ``SoA mkSoAInstanceHandler
+
+end Lean.Elab.Deriving.SoA
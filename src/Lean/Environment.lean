@@ -786,6 +786,12 @@ def displayStats (env : Environment) : IO Unit := do
 @[extern "lean_eval_const"]
 unsafe opaque evalConst (α) (env : @& Environment) (opts : @& Options) (constName : @& Name) : Except String α
 
+/--
+  Number of symbol lookups and constant evaluations the interpreter served from its process-wide caches, which survive
+  changes of the environment. Used for testing. -/
+@[extern "lean_get_interpreter_shared_cache_hits"]
+opaque getInterpreterSharedCacheHits : BaseIO Nat
+
 private def throwUnexpectedType {α} (typeName : Name) (constName : Name) : ExceptT String Id α :=
   throw ("unexpected type at '" ++ toString constName ++ "', `" ++ toString typeName ++ "` expected")
 
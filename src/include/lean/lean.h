@@ -35,10 +35,14 @@ extern "C" {
 #define LEAN_UNLIKELY(x) (__builtin_expect((x), 0))
 #define LEAN_LIKELY(x) (__builtin_expect((x), 1))
 #define LEAN_ALWAYS_INLINE __attribute__((always_inline))
+#define LEAN_COLD __attribute__((cold))
+#define LEAN_CONSTRUCTOR __attribute__((constructor))
 #else
 #define LEAN_UNLIKELY(x) (x)
 #define LEAN_LIKELY(x) (x)
 #define LEAN_ALWAYS_INLINE
+#define LEAN_COLD
+/* `LEAN_CONSTRUCTOR` is intentionally left undefined, code that needs it must fail to compile, see `emitProfileTable`. */
 #endif
 
 #ifndef assert
@@ -255,11 +259,13 @@ typedef struct {
    * Finished
      * condition: m_value != nullptr
      * invariant: m_imp == nullptr
+     * invariant: m_value_st != 0 iff m_value has not been marked as multi-threaded yet (see `lean_task_get`)
      * transition: RC becomes 0 ==> freed (`deactivate_task` lock) */
 typedef struct lean_task {
     lean_object            m_header;
     _Atomic(lean_object *) m_value;
     lean_task_imp *        m_imp;
+    _Atomic(uint8_t)       m_value_st;
 } lean_task_object;
 
 typedef void (*lean_external_finalize_proc)(void *);
@@ -440,6 +446,24 @@ static inline void lean_dec_ref(lean_object * o) {
         lean_dec_ref_cold(o);
     }
 }
+/* RC operations for objects that the compiler has proven to be single threaded heap objects, i.e., `o->m_rc > 0`.
+   See `Lean.IR.ThreadLocal`.
+   Compiling with `LEAN_CHECKED_ST_RC` uses the checked operations instead, e.g. for comparing benchmarks. */
+#ifdef LEAN_CHECKED_ST_RC
+static inline void lean_inc_ref_st(lean_object * o) { lean_inc_ref(o); }
+static inline void lean_inc_ref_n_st(lean_object * o, size_t n) { lean_inc_ref_n(o, n); }
+static inline void lean_dec_ref_st(lean_object * o) { lean_dec_ref(o); }
+#else
+static inline void lean_inc_ref_st(lean_object * o) { o->m_rc++; }
+static inline void lean_inc_ref_n_st(lean_object * o, size_t n) { o->m_rc += n; }
+static inline void lean_dec_ref_st(lean_object * o) {
+    if (LEAN_LIKELY(o->m_rc > 1)) {
+        o->m_rc--;
+    } else {
+        lean_dec_ref_cold(o);
+    }
+}
+#endif
 static inline void lean_inc(lean_object * o) { if (!lean_is_scalar(o)) lean_inc_ref(o); }
 static inline void lean_inc_n(lean_object * o, size_t n) { if (!lean_is_scalar(o)) lean_inc_ref_n(o, n); }
 static inline void lean_dec(lean_object * o) { if (!lean_is_scalar(o)) lean_dec_ref(o); }
@@ -539,6 +563,23 @@ static inline lean_object * lean_alloc_ctor(unsigned tag, unsigned num_objs, uns
     return o;
 }
 
+/* Initialize a constructor object in memory provided by the caller, e.g., a buffer on the C stack
+   of at least `sizeof(lean_ctor_object) + sizeof(void*)*num_objs + scalar_sz` bytes.
+   The object is not stored in the heap, so `lean_inc` and `lean_dec` are no-ops on it.
+   The caller must ensure it does not escape, and release its fields using `lean_free_stack_ctor`.
+   Compiling with `LEAN_NO_STACK_CTORS` allocates these objects on the heap instead, e.g. for comparing benchmarks. */
+static inline lean_object * lean_alloc_stack_ctor(void * buf, unsigned tag, unsigned num_objs, unsigned scalar_sz) {
+#ifdef LEAN_NO_STACK_CTORS
+    (void)buf;
+    return lean_alloc_ctor(tag, num_objs, scalar_sz);
+#else
+    assert(tag <= LeanMaxCtorTag && num_objs < LEAN_MAX_CTOR_FIELDS && scalar_sz < LEAN_MAX_CTOR_SCALARS_SIZE);
+    lean_object * o = (lean_object*)buf;
+    lean_set_non_heap_header(o, sizeof(lean_ctor_object) + sizeof(void*)*num_objs + scalar_sz, tag, num_objs);
+    return o;
+#endif
+}
+
 static inline b_lean_obj_res lean_ctor_get(b_lean_obj_arg o, unsigned i) {
     assert(i < lean_ctor_num_objs(o));
     return lean_ctor_obj_cptr(o)[i];
@@ -554,6 +595,15 @@ static inline void lean_ctor_set_tag(b_lean_obj_arg o, uint8_t new_tag) {
     o->m_tag = new_tag;
 }
 
+/* Prepare the exclusive constructor object `o` for being reused by a constructor with tag `tag` and `num_objs` object
+   fields, whose layout may differ from the previous one (see `compiler.reuseSizeClass`). As in `lean_alloc_ctor_memory`,
+   we clear the last word of the cell since the new constructor may not overwrite it. */
+static inline void lean_ctor_reuse_set_header(lean_object * o, unsigned tag, unsigned num_objs) {
+    size_t * end = (size_t*)(((char*)o) + lean_small_object_size(o));
+    end[-1] = 0;
+    lean_set_st_header(o, tag, num_objs);
+}
+
 static inline void lean_ctor_release(b_lean_obj_arg o, unsigned i) {
     assert(i < lean_ctor_num_objs(o));
     lean_object ** objs = lean_ctor_obj_cptr(o);
@@ -561,6 +611,17 @@ static inline void lean_ctor_release(b_lean_obj_arg o, unsigned i) {
     objs[i] = lean_box(0);
 }
 
+/* Release the fields of a constructor object created with `lean_alloc_stack_ctor`. */
+static inline void lean_free_stack_ctor(b_lean_obj_arg o) {
+#ifdef LEAN_NO_STACK_CTORS
+    lean_dec(o);
+#else
+    unsigned n = lean_ctor_num_objs(o);
+    lean_object ** objs = lean_ctor_obj_cptr(o);
+    for (unsigned i = 0; i < n; i++) lean_dec(objs[i]);
+#endif
+}
+
 static inline size_t lean_ctor_get_usize(b_lean_obj_arg o, unsigned i) {
     assert(i >= lean_ctor_num_objs(o));
     return *((size_t*)(lean_ctor_obj_cptr(o) + i));
@@ -904,6 +965,14 @@ static inline lean_obj_res lean_byte_array_fset(lean_obj_arg a, b_lean_obj_arg i
     return lean_byte_array_uset(a, lean_unbox(i), b);
 }
 
+/* Bulk operations. Functions taking an owned array update it in place if it is exclusive. */
+
+LEAN_SHARED lean_obj_res lean_byte_array_fill(lean_obj_arg a, uint8_t v);
+LEAN_SHARED uint8_t lean_byte_array_beq(b_lean_obj_arg a, b_lean_obj_arg b);
+LEAN_SHARED uint8_t lean_byte_array_compare(b_lean_obj_arg a, b_lean_obj_arg b);
+LEAN_SHARED lean_obj_res lean_byte_array_index_of(b_lean_obj_arg a, uint8_t v, b_lean_obj_arg start);
+LEAN_SHARED uint64_t lean_byte_array_hash(b_lean_obj_arg a);
+
 /* FloatArray (special case of Array of Scalars) */
 
 LEAN_SHARED lean_obj_res lean_float_array_mk(lean_obj_arg a);
@@ -969,6 +1038,119 @@ static inline lean_obj_res lean_float_array_set(lean_obj_arg a, b_lean_obj_arg i
     }
 }
 
+/* Bulk operations. Functions taking an owned array update it in place if it is exclusive. */
+
+LEAN_SHARED lean_obj_res lean_float_array_fill(lean_obj_arg a, double v);
+LEAN_SHARED lean_obj_res lean_float_array_add(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_SHARED lean_obj_res lean_float_array_sub(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_SHARED lean_obj_res lean_float_array_mul(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_SHARED lean_obj_res lean_float_array_scale(lean_obj_arg a, double c);
+LEAN_SHARED lean_obj_res lean_float_array_axpy(double c, b_lean_obj_arg x, lean_obj_arg y);
+LEAN_SHARED double lean_float_array_sum(b_lean_obj_arg a);
+LEAN_SHARED double lean_float_array_dot(b_lean_obj_arg a, b_lean_obj_arg b);
+LEAN_SHARED double lean_float_array_min(b_lean_obj_arg a);
+LEAN_SHARED double lean_float_array_max(b_lean_obj_arg a);
+
+/* Helpers shared by the scalar arrays `UInt16Array`, `UInt32Array`, and `UInt64Array` */
+
+LEAN_SHARED lean_obj_res lean_copy_sarray(lean_obj_arg a, size_t capacity);
+
+static inline lean_obj_res lean_mk_empty_sarray(unsigned elem_size, b_lean_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    return lean_alloc_sarray(elem_size, 0, lean_unbox(capacity));
+}
+
+/* Return `a` if it is exclusive, and a copy of it otherwise. */
+static inline lean_obj_res lean_sarray_exclusive(lean_obj_arg a) {
+    return lean_is_exclusive(a) ? a : lean_copy_sarray(a, lean_sarray_capacity(a));
+}
+
+/* Store the value of the `Nat` index `i` in `*idx` and return `true` if it is in bounds. A big `i` must be out of
+   bounds, otherwise we would be out of memory. */
+static inline bool lean_sarray_get_index(b_lean_obj_arg a, b_lean_obj_arg i, size_t * idx) {
+    if (!lean_is_scalar(i)) return false;
+    *idx = lean_unbox(i);
+    return *idx < lean_sarray_size(a);
+}
+
+/* UInt16Array (special case of Array of Scalars), see `lean_sarray_*` above */
+
+LEAN_SHARED lean_obj_res lean_uint16_array_mk(lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_uint16_array_data(lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_uint16_array_push(lean_obj_arg a, uint16_t d);
+
+static inline lean_obj_res lean_mk_empty_uint16_array(b_lean_obj_arg capacity) { return lean_mk_empty_sarray(sizeof(uint16_t), capacity); }
+static inline lean_obj_res lean_uint16_array_size(b_lean_obj_arg a) { return lean_box(lean_sarray_size(a)); }
+static inline uint16_t * lean_uint16_array_cptr(b_lean_obj_arg a) { return (uint16_t*)(lean_sarray_cptr(a)); } // NOLINT
+static inline uint16_t lean_uint16_array_uget(b_lean_obj_arg a, size_t i) { return lean_uint16_array_cptr(a)[i]; }
+static inline uint16_t lean_uint16_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) { return lean_uint16_array_uget(a, lean_unbox(i)); }
+static inline uint16_t lean_uint16_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    size_t idx;
+    return lean_sarray_get_index(a, i, &idx) ? lean_uint16_array_uget(a, idx) : 0;
+}
+static inline lean_obj_res lean_uint16_array_uset(lean_obj_arg a, size_t i, uint16_t d) {
+    lean_obj_res r = lean_sarray_exclusive(a);
+    lean_uint16_array_cptr(r)[i] = d;
+    return r;
+}
+static inline lean_obj_res lean_uint16_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint16_t d) { return lean_uint16_array_uset(a, lean_unbox(i), d); }
+static inline lean_obj_res lean_uint16_array_set(lean_obj_arg a, b_lean_obj_arg i, uint16_t d) {
+    size_t idx;
+    return lean_sarray_get_index(a, i, &idx) ? lean_uint16_array_uset(a, idx, d) : a;
+}
+
+/* UInt32Array (special case of Array of Scalars), see `lean_sarray_*` above */
+
+LEAN_SHARED lean_obj_res lean_uint32_array_mk(lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_uint32_array_data(lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_uint32_array_push(lean_obj_arg a, uint32_t d);
+
+static inline lean_obj_res lean_mk_empty_uint32_array(b_lean_obj_arg capacity) { return lean_mk_empty_sarray(sizeof(uint32_t), capacity); }
+static inline lean_obj_res lean_uint32_array_size(b_lean_obj_arg a) { return lean_box(lean_sarray_size(a)); }
+static inline uint32_t * lean_uint32_array_cptr(b_lean_obj_arg a) { return (uint32_t*)(lean_sarray_cptr(a)); } // NOLINT
+static inline uint32_t lean_uint32_array_uget(b_lean_obj_arg a, size_t i) { return lean_uint32_array_cptr(a)[i]; }
+static inline uint32_t lean_uint32_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) { return lean_uint32_array_uget(a, lean_unbox(i)); }
+static inline uint32_t lean_uint32_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    size_t idx;
+    return lean_sarray_get_index(a, i, &idx) ? lean_uint32_array_uget(a, idx) : 0;
+}
+static inline lean_obj_res lean_uint32_array_uset(lean_obj_arg a, size_t i, uint32_t d) {
+    lean_obj_res r = lean_sarray_exclusive(a);
+    lean_uint32_array_cptr(r)[i] = d;
+    return r;
+}
+static inline lean_obj_res lean_uint32_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint32_t d) { return lean_uint32_array_uset(a, lean_unbox(i), d); }
+static inline lean_obj_res lean_uint32_array_set(lean_obj_arg a, b_lean_obj_arg i, uint32_t d) {
+    size_t idx;
+    return lean_sarray_get_index(a, i, &idx) ? lean_uint32_array_uset(a, idx, d) : a;
+}
+
+/* UInt64Array (special case of Array of Scalars), see `lean_sarray_*` above */
+
+LEAN_SHARED lean_obj_res lean_uint64_array_mk(lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_uint64_array_data(lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_uint64_array_push(lean_obj_arg a, uint64_t d);
+
+static inline lean_obj_res lean_mk_empty_uint64_array(b_lean_obj_arg capacity) { return lean_mk_empty_sarray(sizeof(uint64_t), capacity); }
+static inline lean_obj_res lean_uint64_array_size(b_lean_obj_arg a) { return lean_box(lean_sarray_size(a)); }
+static inline uint64_t * lean_uint64_array_cptr(b_lean_obj_arg a) { return (uint64_t*)(lean_sarray_cptr(a)); } // NOLINT
+static inline uint64_t lean_uint64_array_uget(b_lean_obj_arg a, size_t i) { return lean_uint64_array_cptr(a)[i]; }
+static inline uint64_t lean_uint64_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) { return lean_uint64_array_uget(a, lean_unbox(i)); }
+static inline uint64_t lean_uint64_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    size_t idx;
+    return lean_sarray_get_index(a, i, &idx) ? lean_uint64_array_uget(a, idx) : 0;
+}
+static inline lean_obj_res lean_uint64_array_uset(lean_obj_arg a, size_t i, uint64_t d) {
+    lean_obj_res r = lean_sarray_exclusive(a);
+    lean_uint64_array_cptr(r)[i] = d;
+    return r;
+}
+static inline lean_obj_res lean_uint64_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint64_t d) { return lean_uint64_array_uset(a, lean_unbox(i), d); }
+static inline lean_obj_res lean_uint64_array_set(lean_obj_arg a, b_lean_obj_arg i, uint64_t d) {
+    size_t idx;
+    return lean_sarray_get_index(a, i, &idx) ? lean_uint64_array_uset(a, idx, d) : a;
+}
+
 /* Strings */
 
 static inline lean_obj_res lean_alloc_string(size_t size, size_t capacity, size_t len) {
@@ -1858,6 +2040,24 @@ static inline uint8_t lean_float_decLe(double a, double b) { return a <= b; }
 static inline uint8_t lean_float_decLt(double a, double b) { return a < b; }
 static inline double lean_uint64_to_float(uint64_t a) { return (double) a; }
 
+/* Profile counters of code compiled with `lean --profile-instrument`, see `Lean.IR.Profile`. */
+
+typedef struct {
+    char const *         m_name;     // C name of the function
+    _Atomic(uint64_t) *  m_counters; // incremented concurrently by all threads executing the function
+    size_t               m_size;
+} lean_prof_entry;
+
+typedef struct lean_prof_module {
+    lean_prof_entry const *   m_entries;
+    size_t                    m_size;
+    struct lean_prof_module * m_next;
+} lean_prof_module;
+
+/* Register the counters of a translation unit. They are written to the profile file at exit.
+   Remark: it is usually invoked before `main`, but it may also be invoked concurrently when shared libraries are loaded. */
+LEAN_SHARED void lean_prof_register(lean_prof_module * m);
+
 #ifdef __cplusplus
 }
 #endif
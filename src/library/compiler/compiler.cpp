@@ -4,6 +4,10 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
 #include "util/option_declarations.h"
 #include "util/io.h"
 #include "kernel/type_checker.h"
@@ -34,8 +38,14 @@ Author: Leonardo de Moura
 
 namespace lean {
 static name * g_extract_closed = nullptr;
+static name * g_compiler_parallel = nullptr;
+
+#ifndef LEAN_DEFAULT_COMPILER_PARALLEL
+#define LEAN_DEFAULT_COMPILER_PARALLEL false
+#endif
 
 bool is_extract_closed_enabled(options const & opts) { return opts.get_bool(*g_extract_closed, true); }
+static bool is_parallel_enabled(options const & opts) { return opts.get_bool(*g_compiler_parallel, LEAN_DEFAULT_COMPILER_PARALLEL); }
 
 static name get_real_name(name const & n) {
     if (optional<name> new_n = is_unsafe_rec_name(n))
@@ -65,6 +75,95 @@ comp_decls apply(F && f, comp_decls const & ds) {
     return map(ds, [&](comp_decl const & d) { return comp_decl(d.fst(), f(d.snd())); });
 }
 
+/* Parallel compilation (`compiler.parallel`)
+
+   The stages that only read the environment are applied to each declaration of a block in its own job. Stages that
+   add auxiliary declarations or closed terms to the environment (lambda lifting, specialization, closed term
+   extraction, ...) still process the whole block sequentially, and the results of the jobs are collected in the
+   order of the block, so the generated code and names do not depend on scheduling.
+
+   The jobs share the environment, so it is marked as multi-threaded once per block. Objects already marked by a
+   previous block are not traversed again, so this only visits the part of the environment added since then.
+   Jobs are claimed from a shared counter by helper tasks and by the calling thread itself, which only waits for jobs
+   that are already running. Thus, compiling from inside a task (e.g. in the server) cannot deadlock the thread pool
+   even if no worker is available for the helpers. */
+struct comp_par_state {
+    std::vector<std::function<expr()>> m_jobs;
+    std::vector<expr>                  m_results;
+    std::vector<std::exception_ptr>    m_exs;
+    mutex                              m_mutex;
+    condition_variable                 m_done_cv;
+    size_t                             m_next{0};
+    size_t                             m_num_done{0};
+
+    /* Run unclaimed jobs until there are none left. */
+    void run() {
+        while (true) {
+            size_t i;
+            {
+                lock_guard<mutex> lock(m_mutex);
+                if (m_next == m_jobs.size())
+                    return;
+                i = m_next++;
+            }
+            try {
+                m_results[i] = m_jobs[i]();
+            } catch (...) {
+                m_exs[i] = std::current_exception();
+            }
+            lock_guard<mutex> lock(m_mutex);
+            if (++m_num_done == m_jobs.size())
+                m_done_cv.notify_all();
+        }
+    }
+};
+
+static obj_res comp_par_helper_fn(obj_arg s, obj_arg /* unit */) {
+    /* Helpers that start after all jobs have been claimed return immediately, and the state stays alive until they
+       have released it. */
+    std::shared_ptr<comp_par_state> * state = reinterpret_cast<std::shared_ptr<comp_par_state> *>(lean_unbox_usize(s));
+    lean_dec(s);
+    (*state)->run();
+    delete state;
+    return box(0);
+}
+
+/* Similar to `apply`, but apply `f` to the declarations in parallel. */
+template<typename F>
+comp_decls apply_par(F && f, environment const & env, comp_decls const & ds) {
+    size_t n = length(ds);
+    if (n < 2) return apply(f, env, ds);
+    lean_mark_mt(env.raw());
+    auto state = std::make_shared<comp_par_state>();
+    for (comp_decl const & d : ds) {
+        expr v = d.snd();
+        lean_mark_mt(v.raw());
+        state->m_jobs.emplace_back([&f, &env, v]() { return f(env, v); });
+    }
+    state->m_results.resize(n);
+    state->m_exs.resize(n);
+    for (size_t i = 0; i + 1 < n; i++) {
+        object * c = lean_alloc_closure((void*)comp_par_helper_fn, 2, 1);
+        lean_closure_set(c, 0, lean_box_usize(reinterpret_cast<size_t>(new std::shared_ptr<comp_par_state>(state))));
+        // the helper must run even though we drop the task
+        lean_dec(lean_task_spawn_core(c, 0, true));
+    }
+    state->run();
+    {
+        unique_lock<mutex> lock(state->m_mutex);
+        state->m_done_cv.wait(lock, [&]() { return state->m_num_done == n; });
+    }
+    buffer<comp_decl> r;
+    unsigned i = 0;
+    for (comp_decl const & d : ds) {
+        if (state->m_exs[i]) std::rethrow_exception(state->m_exs[i]);
+        // move the result out so that a helper releasing `state` late does not touch it
+        r.push_back(comp_decl(d.fst(), std::move(state->m_results[i])));
+        i++;
+    }
+    return comp_decls(r);
+}
+
 void trace_comp_decl(comp_decl const & d) {
     tout() << ">> " << d.fst() << "\n" << trace_pp_expr(d.snd()) << "\n";
 }
@@ -204,19 +303,32 @@ environment compile(environment const & env, options const & opts, names cs) {
     // scope_traces_as_string trace_scope;
     auto simp  = [&](environment const & env, expr const & e) { return csimp(env, e, cfg); };
     auto esimp = [&](environment const & env, expr const & e) { return cesimp(env, e, cfg); };
+    /* Intermediate traces are only produced by the sequential pipeline. */
+    bool par = is_parallel_enabled(opts) && !is_trace_enabled();
     trace_compiler(name({"compiler", "input"}), ds);
-    ds = apply(eta_expand, env, ds);
-    trace_compiler(name({"compiler", "eta_expand"}), ds);
-    ds = apply(to_lcnf, env, ds);
-    ds = apply(find_jp, env, ds);
-    // trace(ds);
-    trace_compiler(name({"compiler", "lcnf"}), ds);
-    // trace(ds);
-    ds = apply(cce, env, ds);
-    trace_compiler(name({"compiler", "cce"}), ds);
-    ds = apply(csimp_replace_constants, env, ds);
-    ds = apply(simp, env, ds);
-    trace_compiler(name({"compiler", "simp"}), ds);
+    if (par) {
+        ds = apply_par([&](environment const & env, expr e) {
+                e = eta_expand(env, e);
+                e = to_lcnf(env, e);
+                e = find_jp(env, e);
+                e = cce(env, e);
+                e = csimp_replace_constants(env, e);
+                return simp(env, e);
+            }, env, ds);
+    } else {
+        ds = apply(eta_expand, env, ds);
+        trace_compiler(name({"compiler", "eta_expand"}), ds);
+        ds = apply(to_lcnf, env, ds);
+        ds = apply(find_jp, env, ds);
+        // trace(ds);
+        trace_compiler(name({"compiler", "lcnf"}), ds);
+        // trace(ds);
+        ds = apply(cce, env, ds);
+        trace_compiler(name({"compiler", "cce"}), ds);
+        ds = apply(csimp_replace_constants, env, ds);
+        ds = apply(simp, env, ds);
+        trace_compiler(name({"compiler", "simp"}), ds);
+    }
     // trace(ds);
     environment new_env = env;
     std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg);
@@ -233,17 +345,32 @@ environment compile(environment const & env, options const & opts, names cs) {
            when it is partially applied. Then, we can mark all `match` auxiliary functions as `[strong_inline]` */
         return new_env;
     }
-    std::tie(new_env, ds) = specialize(new_env, ds, cfg);
+    spec_cache_stats spec_stats;
+    std::tie(new_env, ds) = specialize(new_env, ds, cfg, spec_stats);
+    if (get_profiler(opts)) {
+        report_profiling_counter("specialization cache hits", spec_stats.m_hits);
+        report_profiling_counter("specialization cache misses", spec_stats.m_misses);
+        report_profiling_counter("uncached specializations", spec_stats.m_uncached);
+    }
     lean_assert(lcnf_check_let_decls(new_env, ds));
     trace_compiler(name({"compiler", "specialize"}), ds);
-    ds = apply(elim_dead_let, ds);
-    trace_compiler(name({"compiler", "elim_dead_let"}), ds);
-    ds = apply(erase_irrelevant, new_env, ds);
-    trace_compiler(name({"compiler", "erase_irrelevant"}), ds);
-    ds = apply(struct_cases_on, new_env, ds);
-    trace_compiler(name({"compiler", "struct_cases_on"}), ds);
-    ds = apply(esimp, new_env, ds);
-    trace_compiler(name({"compiler", "simp"}), ds);
+    if (par) {
+        ds = apply_par([&](environment const & env, expr e) {
+                e = elim_dead_let(e);
+                e = erase_irrelevant(env, e);
+                e = struct_cases_on(env, e);
+                return esimp(env, e);
+            }, new_env, ds);
+    } else {
+        ds = apply(elim_dead_let, ds);
+        trace_compiler(name({"compiler", "elim_dead_let"}), ds);
+        ds = apply(erase_irrelevant, new_env, ds);
+        trace_compiler(name({"compiler", "erase_irrelevant"}), ds);
+        ds = apply(struct_cases_on, new_env, ds);
+        trace_compiler(name({"compiler", "struct_cases_on"}), ds);
+        ds = apply(esimp, new_env, ds);
+        trace_compiler(name({"compiler", "simp"}), ds);
+    }
     ds = reduce_arity(new_env, ds);
     trace_compiler(name({"compiler", "reduce_arity"}), ds);
     std::tie(new_env, ds) = lambda_lifting(new_env, ds);
@@ -260,11 +387,20 @@ environment compile(environment const & env, options const & opts, names cs) {
         trace_compiler(name({"compiler", "extract_closed"}), ds);
     }
     new_env = cache_new_stage2(new_env, ds);
-    ds = apply(esimp, new_env, ds);
-    trace_compiler(name({"compiler", "simp"}), ds);
-    ds = apply(simp_app_args, new_env, ds);
-    ds = apply(ecse, new_env, ds);
-    ds = apply(elim_dead_let, ds);
+    if (par) {
+        ds = apply_par([&](environment const & env, expr e) {
+                e = esimp(env, e);
+                e = simp_app_args(env, e);
+                e = ecse(env, e);
+                return elim_dead_let(e);
+            }, new_env, ds);
+    } else {
+        ds = apply(esimp, new_env, ds);
+        trace_compiler(name({"compiler", "simp"}), ds);
+        ds = apply(simp_app_args, new_env, ds);
+        ds = apply(ecse, new_env, ds);
+        ds = apply(elim_dead_let, ds);
+    }
     trace_compiler(name({"compiler", "simp_app_args"}), ds);
     // std::cout << trace_scope.get_string() << "\n";
     /* compile IR. */
@@ -281,6 +417,10 @@ void initialize_compiler() {
     g_extract_closed = new name{"compiler", "extract_closed"};
     mark_persistent(g_extract_closed->raw());
     register_bool_option(*g_extract_closed, true, "(compiler) enable/disable closed term caching");
+    g_compiler_parallel = new name{"compiler", "parallel"};
+    mark_persistent(g_compiler_parallel->raw());
+    register_bool_option(*g_compiler_parallel, LEAN_DEFAULT_COMPILER_PARALLEL,
+                         "(compiler) run the compiler stages that do not modify the environment in one task per declaration");
     register_trace_class("compiler");
     register_trace_class({"compiler", "input"});
     register_trace_class({"compiler", "inline"});
@@ -315,6 +455,8 @@ void initialize_compiler() {
     register_trace_class({"compiler", "ir", "elim_dead"});
     register_trace_class({"compiler", "ir", "simp_case"});
     register_trace_class({"compiler", "ir", "borrow"});
+    register_trace_class({"compiler", "ir", "borrow_summary"});
+    register_trace_class({"compiler", "ir", "borrow_rc_stats"});
     register_trace_class({"compiler", "ir", "boxing"});
     register_trace_class({"compiler", "ir", "rc"});
     register_trace_class({"compiler", "ir", "expand_reset_reuse"});
@@ -323,5 +465,6 @@ void initialize_compiler() {
 
 void finalize_compiler() {
     delete g_extract_closed;
+    delete g_compiler_parallel;
 }
 }
@@ -7,6 +7,8 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <unordered_set>
 #include <unordered_map>
+#include <sstream>
+#include <string>
 #include "runtime/flet.h"
 #include "kernel/type_checker.h"
 #include "kernel/for_each_fn.h"
@@ -27,6 +29,12 @@ Author: Leonardo de Moura
 #include "library/compiler/extract_closed.h"
 #include "library/compiler/reduce_arity.h"
 #include "library/compiler/init_attribute.h"
+#include "library/compiler/export_attribute.h"
+
+#ifndef LEAN_PROFILE_HOT_RATIO
+/* A function is hot if it is called at least 1/LEAN_PROFILE_HOT_RATIO times as often as the most called function. */
+#define LEAN_PROFILE_HOT_RATIO 100
+#endif
 
 namespace lean {
 csimp_cfg::csimp_cfg(options const &):
@@ -38,6 +46,48 @@ csimp_cfg::csimp_cfg() {
     m_inline_threshold                = 1;
     m_float_cases_threshold           = 20;
     m_inline_jp_threshold             = 2;
+    m_profile_inline_threshold        = 16;
+}
+
+/* Number of calls of each function in the profile set with `set_profile_data`, indexed by C function name. */
+static std::unordered_map<std::string, uint64_t> * g_profile_calls = nullptr;
+static uint64_t g_profile_hot_calls = 0;
+
+void set_profile_data(std::string const & data) {
+    /* One line `<C function name> <counter> <value>` per counter, where counter 0 counts the calls of the function.
+       Counters of repeated runs are added. */
+    auto calls = new std::unordered_map<std::string, uint64_t>();
+    std::istringstream in(data);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream line_in(line);
+        std::string fn;
+        unsigned long long i, n;
+        if (line_in >> fn >> i >> n && i == 0)
+            (*calls)[fn] += n;
+    }
+    uint64_t max_calls = 0;
+    for (auto const & p : *calls)
+        max_calls = std::max(max_calls, p.second);
+    g_profile_hot_calls = std::max<uint64_t>(1, max_calls / LEAN_PROFILE_HOT_RATIO);
+    delete g_profile_calls;
+    g_profile_calls = calls;
+}
+
+extern "C" object * lean_name_mangle(object * n, object * pre);
+
+static bool is_hot_in_profile(environment const & env, name const & fn) {
+    if (!g_profile_calls) return false;
+    /* Must match `EmitC.toCName` */
+    std::string c_name;
+    if (optional<name> export_name = get_export_name_for(env, fn)) {
+        if (!export_name->is_string() || !export_name->get_prefix().is_anonymous()) return false;
+        c_name = export_name->get_string().to_std_string();
+    } else {
+        c_name = string_ref(lean_name_mangle(fn.to_obj_arg(), mk_string("l_"))).to_std_string();
+    }
+    auto it = g_profile_calls->find(c_name);
+    return it != g_profile_calls->end() && it->second >= g_profile_hot_calls;
 }
 
 /*
@@ -1742,10 +1792,13 @@ class csimp_fn {
             if (get_app_num_args(e) < get_num_nested_lambdas(info->get_value())) return none_expr();
             bool inline_attr           = has_inline_attribute(env(), const_name(fn));
             bool inline_if_reduce_attr = has_inline_if_reduce_attribute(env(), const_name(fn));
-            if (!inline_attr && !inline_if_reduce_attr &&
-                (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold ||
-                 is_constant(e))) { /* We only inline constants if they are marked with the `[inline]` or `[inline_if_reduce]` attrs */
-                return none_expr();
+            if (!inline_attr && !inline_if_reduce_attr) {
+                /* We only inline constants if they are marked with the `[inline]` or `[inline_if_reduce]` attrs */
+                if (is_constant(e)) return none_expr();
+                unsigned size = get_lcnf_size(env(), info->get_value());
+                if (size > m_cfg.m_inline_threshold &&
+                    (size > m_cfg.m_profile_inline_threshold || !is_hot_in_profile(env(), const_name(fn))))
+                    return none_expr();
             }
             if (!inline_if_reduce_attr && is_recursive(const_name(fn))) return none_expr();
             if (!is_matcher(env(), const_name(fn))) {
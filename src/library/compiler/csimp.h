@@ -18,11 +18,18 @@ struct csimp_cfg {
     unsigned m_float_cases_threshold;
     /* We inline join-points that are smaller m_inline_threshold. */
     unsigned m_inline_jp_threshold;
+    /* We also inline functions that are smaller than m_profile_inline_threshold if the profile set with
+       `set_profile_data` shows that they are hot. */
+    unsigned m_profile_inline_threshold;
 public:
     csimp_cfg(options const & opts);
     csimp_cfg();
 };
 
+/* Set the content of the profile file passed with `--profile-use`, see `Lean.IR.Profile`.
+   It must be called before compilation starts. */
+void set_profile_data(std::string const & data);
+
 expr csimp_core(environment const & env, local_ctx const & lctx, expr const & e, bool before_erasure, csimp_cfg const & cfg);
 inline expr csimp(environment const & env, expr const & e, csimp_cfg const & cfg = csimp_cfg()) {
     return csimp_core(env, local_ctx(), e, true, cfg);
@@ -575,10 +575,10 @@ extern "C" LEAN_EXPORT object* lean_add_extern(object * env, object * fn) {
     }
 }
 
-extern "C" object * lean_ir_emit_c(object * env, object * mod_name);
+extern "C" object * lean_ir_emit_c(object * env, object * mod_name, uint8 profile_instrument, object * profile_data);
 
-string_ref emit_c(environment const & env, name const & mod_name) {
-    object * r = lean_ir_emit_c(env.to_obj_arg(), mod_name.to_obj_arg());
+string_ref emit_c(environment const & env, name const & mod_name, bool profile_instrument, std::string const & profile_data) {
+    object * r = lean_ir_emit_c(env.to_obj_arg(), mod_name.to_obj_arg(), profile_instrument, mk_string(profile_data));
     string_ref s(cnstr_get(r, 0), true);
     if (cnstr_tag(r) == 0) {
         dec_ref(r);
@@ -589,6 +589,24 @@ string_ref emit_c(environment const & env, name const & mod_name) {
     }
 }
 
+extern "C" object * lean_ir_emit_c_shards(object * env, object * mod_name, object * header_name, object * num_shards,
+                                          uint8 profile_instrument, object * profile_data);
+
+array_ref<string_ref> emit_c_shards(environment const & env, name const & mod_name, std::string const & header_name, unsigned num_shards,
+                                    bool profile_instrument, std::string const & profile_data) {
+    object * r = lean_ir_emit_c_shards(env.to_obj_arg(), mod_name.to_obj_arg(), mk_string(header_name), mk_nat_obj(num_shards),
+                                       profile_instrument, mk_string(profile_data));
+    if (cnstr_tag(r) == 0) {
+        string_ref s(cnstr_get(r, 0), true);
+        dec_ref(r);
+        throw exception(s.to_std_string());
+    } else {
+        array_ref<string_ref> fs(cnstr_get(r, 0), true);
+        dec_ref(r);
+        return fs;
+    }
+}
+
 /*
 inductive CtorFieldInfo
 | irrelevant
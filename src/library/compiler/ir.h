@@ -6,6 +6,7 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <string>
+#include "runtime/array_ref.h"
 #include "kernel/environment.h"
 #include "library/compiler/util.h"
 namespace lean {
@@ -36,7 +37,13 @@ std::string decl_to_string(decl const & d);
 void test(decl const & d);
 environment compile(environment const & env, options const & opts, comp_decls const & decls);
 environment add_extern(environment const & env, name const & fn);
-string_ref emit_c(environment const & env, name const & mod_name);
+/* If `profile_instrument` is true, the C code counts function calls and branches. `profile_data` is the content of a
+   profile file used for code generation. See `Lean.IR.Profile`. */
+string_ref emit_c(environment const & env, name const & mod_name, bool profile_instrument = false,
+                  std::string const & profile_data = std::string());
+/* Return the header, the main translation unit, and `num_shards` translation units of the module, see `emitCShards`. */
+array_ref<string_ref> emit_c_shards(environment const & env, name const & mod_name, std::string const & header_name, unsigned num_shards,
+                                    bool profile_instrument = false, std::string const & profile_data = std::string());
 }
 void initialize_ir();
 void finalize_ir();
@@ -13,6 +13,10 @@ Even with a JIT compiler, we still have a need for a simpler interpreter on plat
 WebAssembly). Because this is mostly an edge case, we strive for simplicity instead of performance and thus reuse the
 existing compiler IR instead of inventing something like a new bytecode format.
 
+However, since a lot of `#eval`, macro, and tactic code is interpreted during elaboration, there is an optional
+(`interpreter.bytecode`) lowering of IR declarations into a compact, pre-decoded bytecode that avoids walking the IR
+objects; see `code` below.
+
 Implementation
 ==============
 
@@ -28,6 +32,11 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 */
 #include <string>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
 #ifdef LEAN_WINDOWS
 #include <windows.h>
 #include <psapi.h>
@@ -40,6 +49,7 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #include "runtime/io.h"
 #include "runtime/option_ref.h"
 #include "runtime/array_ref.h"
+#include "runtime/allocprof.h"
 #include "library/time_task.h"
 #include "library/trace.h"
 #include "library/compiler/ir.h"
@@ -51,6 +61,14 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #define LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE true
 #endif
 
+#ifndef LEAN_DEFAULT_INTERPRETER_BYTECODE
+#define LEAN_DEFAULT_INTERPRETER_BYTECODE false
+#endif
+
+#ifndef LEAN_INTERPRETER_SHARED_CACHE_SIZE
+#define LEAN_INTERPRETER_SHARED_CACHE_SIZE 65536
+#endif
+
 namespace lean {
 namespace ir {
 // C++ wrappers of Lean data types
@@ -191,6 +209,9 @@ static string_ref * g_mangle_prefix = nullptr;
 static string_ref * g_boxed_suffix = nullptr;
 static string_ref * g_boxed_mangled_suffix = nullptr;
 static name * g_interpreter_prefer_native = nullptr;
+static name * g_interpreter_bytecode = nullptr;
+static name * g_interpreter_profile = nullptr;
+static mutex * g_interpreter_profile_mutex = nullptr;
 
 // constants (lacking native declarations) initialized by `lean_run_init`
 static name_map<object *> * g_init_globals;
@@ -320,19 +341,58 @@ class interpreter {
     std::vector<value> m_arg_stack;
     // stack of join points
     std::vector<fn_body const *> m_jp_stack;
+    struct profile_node;
     struct frame {
         name m_fn;
         // base pointers into the stack above
         size_t m_arg_bp;
         size_t m_jp_bp;
+        // call profiler data, only used if `m_profile_root` is set
+        profile_node * m_prof = nullptr;
+        std::chrono::steady_clock::time_point m_prof_start;
 
         frame(name const & mFn, size_t mArgBp, size_t mJpBp) : m_fn(mFn), m_arg_bp(mArgBp), m_jp_bp(mJpBp) {}
     };
     std::vector<frame> m_call_stack;
+    /* Call profiler (`interpreter.profile`)
+       ================
+
+       An exact call tree of the interpreted and native calls made by this interpreter, with call counts and inclusive
+       time per node. When the interpreter is destroyed, it is appended to the given file as folded stacks
+       (`f;g;h <exclusive microseconds>`, as consumed by flamegraph.pl or speedscope), and a per-function summary of calls,
+       inclusive and exclusive time is appended to the same file name with suffix `.functions`. Native calls are marked
+       by the suffix ` [native]`. */
+    struct profile_node {
+        name     m_fn;
+        bool     m_native;
+        uint64   m_calls = 0;
+        // nanoseconds
+        uint64   m_inclusive = 0;
+        uint64   m_callees_time = 0;
+        std::vector<std::unique_ptr<profile_node>> m_callees;
+
+        profile_node(name const & fn, bool native) : m_fn(fn), m_native(native) {}
+
+        profile_node * get_callee(name const & fn, bool native) {
+            for (auto const & c : m_callees) {
+                if (c->m_native == native && c->m_fn == fn) {
+                    return c.get();
+                }
+            }
+            m_callees.emplace_back(new profile_node(fn, native));
+            return m_callees.back().get();
+        }
+    };
+    std::string m_profile_file;
+    std::unique_ptr<profile_node> m_profile_root;
+    // folded stack of the enclosing interpreter on this thread, if any
+    std::string m_profile_prefix;
     environment const & m_env;
     options const & m_opts;
     // if `false`, use IR code where possible
     bool m_prefer_native;
+    // if `true`, execute interpreted declarations via `code` instead of walking their IR
+    bool m_bytecode;
     struct constant_cache_entry {
       bool m_is_scalar;
       value m_val;
@@ -349,6 +409,110 @@ class interpreter {
     // caches symbol lookup successes _and_ failures
     name_map<symbol_cache_entry> m_symbol_cache;
 
+    /* Symbol and constant caches shared by all interpreters, in particular across environments. Entries remember the IR
+       declaration they were computed from and are only reused if the declaration found in the current environment is
+       the same object. This is the case for all environments extending the one the declaration was added to. An entry
+       whose declaration does not match the current environment (e.g. after an edit in the server) is evicted. Cached
+       objects are marked as multi-threaded since interpreters on other threads may use them.
+
+       Each entry keeps its IR declaration and, for constants, the computed value alive, so a map is cleared when it
+       reaches `LEAN_INTERPRETER_SHARED_CACHE_SIZE` entries. Failed symbol lookups are not shared since a later
+       environment may load a shared library providing the symbol. */
+    struct shared_constant_entry {
+        decl       m_decl;
+        bool       m_is_scalar = true;
+        value      m_val = value(static_cast<uint64>(0));
+        // owns `m_val` if it is not a scalar
+        object_ref m_owner;
+    };
+    struct shared_caches {
+        mutex                           m_mutex;
+        // indexed by `m_prefer_native`
+        name_map<symbol_cache_entry>    m_symbols[2];
+        name_map<shared_constant_entry> m_constants;
+        // number of lookups served by the caches above, for testing
+        size_t                          m_num_hits = 0;
+    };
+    static shared_caches * g_shared_caches;
+
+    template<class T>
+    static void insert_shared(name_map<T> & m, name const & fn, T const & e) {
+        if (m.size() >= LEAN_INTERPRETER_SHARED_CACHE_SIZE)
+            m.clear();
+        m.insert(fn, e);
+    }
+
+    /* Bytecode
+       ========
+
+       `compile` lowers the body of an IR declaration into a flat array of instructions. Stack slots are still assigned by
+       IR variable index, so a `code` frame is layout-compatible with the tree walker and rare instructions can fall back
+       to `eval_expr`. In contrast to the tree walker, the frame size is fixed, join points are resolved to instruction
+       indices, `case` uses a jump table, literals are pre-evaluated, and callees are resolved once per call site. */
+    enum class opcode {
+        Ctor,        // x_dst := ctor `imm` with `a` object fields, `b` scalar bytes, and fields `args`
+        Proj,        // x_dst := proj[a] x_b
+        UProj,       // x_dst := uproj[a] x_b
+        SProj,       // x_dst := sproj[imm] x_b
+        Call,        // x_dst := callees[a] args
+        Const,       // x_dst := callees[a]
+        Ap,          // x_dst := x_b args
+        Box,         // x_dst := box x_b, where `a` is the type of x_b
+        Unbox,       // x_dst := unbox x_b
+        Lit,         // x_dst := imm, incrementing the RC if it is an object
+        IsShared,    // x_dst := isShared x_b
+        IsTaggedPtr, // x_dst := isTaggedPtr x_b
+        Expr,        // x_dst := exprs[a], evaluated by `eval_expr`
+        Set,         // set x_dst[a] := args[0]
+        SetTag,      // setTag x_dst := a
+        USet,        // uset x_dst[a] := x_b
+        SSet,        // sset x_dst[imm] := x_b
+        Inc,         // inc x_b a times
+        Dec,         // dec x_b a times
+        Del,         // del x_b
+        Case,        // goto case_targets[a + tag of x_b] if tag < num_args, otherwise case_targets[a + num_args]
+        Ret,         // ret args[0]
+        Jmp,         // first `num_args` entries of `args` := last `num_args` entries, goto a
+        TailCall,    // x_0, ..., x_(num_args - 1) := args, goto 0
+        Unreachable
+    };
+    struct instr {
+        opcode   m_op;
+        type     m_type;     // type of x_dst, or of the scrutinee for `Case`
+        unsigned m_dst;
+        unsigned m_a;
+        unsigned m_b;
+        unsigned m_args;     // index of the first argument in `code::m_args`
+        unsigned m_num_args;
+        value    m_imm;
+    };
+    struct code;
+    // call site, resolved on first execution
+    struct callee {
+        name               m_fn;
+        bool               m_resolved = false;
+        symbol_cache_entry m_sym;
+        // bytecode of interpreted callee
+        code *             m_code = nullptr;
+        // value of constant callee, owned by `m_constant_cache`
+        bool               m_const_cached = false;
+        constant_cache_entry m_const;
+    };
+    struct code {
+        decl                  m_decl;
+        size_t                m_frame_size = 0;
+        std::vector<instr>    m_instrs;
+        // stack slots of arguments, `g_irrelevant_slot` for irrelevant arguments
+        std::vector<unsigned> m_args;
+        std::vector<unsigned> m_case_targets;
+        std::vector<callee>   m_callees;
+        std::vector<expr>     m_exprs;
+    };
+    static constexpr unsigned g_irrelevant_slot = static_cast<unsigned>(-1);
+    static constexpr unsigned g_no_target = static_cast<unsigned>(-1);
+    std::vector<std::unique_ptr<code>> m_codes;
+    name_map<code *> m_code_cache;
+
     /** \brief Get current stack frame */
     inline frame & get_frame() {
         return m_call_stack.back();
@@ -374,13 +538,36 @@ public:
             // We changed threads or the closure was stored and called in a different context.
             time_task t("interpretation", opts, fn);
             scope_trace_env scope_trace(env, opts);
-            // the caches contain data from the Environment, so we cannot reuse them when changing it
+            // the local caches contain data from the Environment, so we cannot reuse them when changing it; entries in
+            // `g_shared_caches` are validated against the new environment instead
             interpreter interp(env, opts);
             flet<interpreter *> fl(g_interpreter, &interp);
             return f(interp);
         }
     }
 
+    static void initialize_shared_caches() {
+        g_shared_caches = new shared_caches();
+    }
+
+    static void finalize_shared_caches() {
+        delete g_shared_caches;
+    }
+
+    static size_t get_shared_cache_hits() {
+        lock_guard<mutex> lock(g_shared_caches->m_mutex);
+        return g_shared_caches->m_num_hits;
+    }
+
+    /** \brief Report the functions being interpreted on this thread to the allocation sampler. */
+    static void get_alloc_sampler_frames(std::vector<std::string> & frames) {
+        if (!g_interpreter)
+            return;
+        std::vector<frame> const & stack = g_interpreter->m_call_stack;
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it)
+            frames.push_back(it->m_fn.to_string());
+    }
+
 private:
     value eval_arg(arg const & a) {
         // an "irrelevant" argument is type- or proof-erased; we can use an arbitrary value for it
@@ -446,7 +633,9 @@ private:
                 } else {
                     // create new constructor object in-place
                     if (expr_reuse_update_header(e)) {
-                        cnstr_set_tag(o, ctor_info_tag(expr_reuse_ctor(e)).get_small_value());
+                        // the cell may come from a constructor with a different number of fields, see `compiler.reuseSizeClass`
+                        lean_ctor_reuse_set_header(o, ctor_info_tag(expr_reuse_ctor(e)).get_small_value(),
+                                                   ctor_info_size(expr_reuse_ctor(e)).get_small_value());
                     }
                     for (size_t i = 0; i < expr_reuse_args(e).size(); i++) {
                         cnstr_set(o, i, eval_arg(expr_reuse_args(e)[i]).m_obj);
@@ -720,8 +909,566 @@ private:
         }
     }
 
+    /** \brief Evaluate the body of `d` in the current stack frame. */
+    value eval_decl(decl const & d) {
+        if (m_bytecode) {
+            return run(get_code(d));
+        } else {
+            return eval_body(decl_fun_body(d));
+        }
+    }
+
+    /** \brief Return cached bytecode of given declaration. */
+    code & get_code(decl const & d) {
+        if (code * const * c = m_code_cache.find(decl_fun_id(d))) {
+            return **c;
+        }
+        m_codes.emplace_back(new code());
+        code & c = *m_codes.back();
+        c.m_decl = d;
+        c.m_frame_size = decl_params(d).size();
+        std::vector<jp_scope_entry> jps;
+        compile(c, decl_fun_body(d), jps);
+        m_code_cache.insert(decl_fun_id(d), &c);
+        return c;
+    }
+
+    // join point visible while compiling its continuation
+    struct jp_scope_entry {
+        size_t                m_id;
+        array_ref<param>      m_params;
+        // `Jmp` instructions to be patched with the index of the join point body
+        std::vector<unsigned> m_jmps;
+    };
+
+    static unsigned slot(code & c, var_id const & v) {
+        // variables are 1-indexed
+        unsigned s = v.get_small_value() - 1;
+        if (s >= c.m_frame_size) {
+            c.m_frame_size = s + 1;
+        }
+        return s;
+    }
+
+    static unsigned add_args(code & c, array_ref<arg> const & args) {
+        unsigned r = c.m_args.size();
+        for (arg const & a : args) {
+            c.m_args.push_back(arg_is_irrelevant(a) ? g_irrelevant_slot : slot(c, arg_var_id(a)));
+        }
+        return r;
+    }
+
+    static unsigned add_callee(code & c, name const & fn) {
+        for (unsigned i = 0; i < c.m_callees.size(); i++) {
+            if (c.m_callees[i].m_fn == fn) {
+                return i;
+            }
+        }
+        c.m_callees.emplace_back();
+        c.m_callees.back().m_fn = fn;
+        return c.m_callees.size() - 1;
+    }
+
+    static unsigned emit(code & c, instr const & i) {
+        c.m_instrs.push_back(i);
+        return c.m_instrs.size() - 1;
+    }
+
+    static void set_instr_args(code & c, instr & i, array_ref<arg> const & args) {
+        i.m_args = add_args(c, args);
+        i.m_num_args = args.size();
+    }
+
+    static void compile_expr(code & c, instr & i, expr const & e) {
+        switch (expr_tag(e)) {
+            case expr_kind::Ctor: {
+                ctor_info const & info = expr_ctor_info(e);
+                size_t usize = ctor_info_usize(info).get_small_value();
+                size_t ssize = ctor_info_ssize(info).get_small_value();
+                i.m_a = ctor_info_size(info).get_small_value();
+                i.m_b = usize * sizeof(void *) + ssize;
+                i.m_imm = ctor_info_tag(info).get_small_value();
+                if (i.m_a == 0 && i.m_b == 0) {
+                    // a constructor without data is optimized to a tagged pointer
+                    i.m_op = opcode::Lit;
+                    i.m_imm = box(i.m_imm.m_num);
+                } else {
+                    i.m_op = opcode::Ctor;
+                    set_instr_args(c, i, expr_ctor_args(e));
+                }
+                return;
+            }
+            case expr_kind::Proj:
+                i.m_op = opcode::Proj;
+                i.m_a = expr_proj_idx(e).get_small_value();
+                i.m_b = slot(c, expr_proj_obj(e));
+                return;
+            case expr_kind::UProj:
+                i.m_op = opcode::UProj;
+                i.m_a = expr_uproj_idx(e).get_small_value();
+                i.m_b = slot(c, expr_uproj_obj(e));
+                return;
+            case expr_kind::SProj:
+                if (i.m_type == type::USize || !type_is_scalar(i.m_type)) {
+                    break;
+                }
+                i.m_op = opcode::SProj;
+                i.m_b = slot(c, expr_sproj_obj(e));
+                i.m_imm = expr_sproj_idx(e).get_small_value() * sizeof(void *) + expr_sproj_offset(e).get_small_value();
+                return;
+            case expr_kind::FAp:
+                i.m_a = add_callee(c, expr_fap_fun(e));
+                if (expr_fap_args(e).size()) {
+                    i.m_op = opcode::Call;
+                    set_instr_args(c, i, expr_fap_args(e));
+                } else {
+                    i.m_op = opcode::Const;
+                }
+                return;
+            case expr_kind::Ap:
+                i.m_op = opcode::Ap;
+                i.m_b = slot(c, expr_ap_fun(e));
+                set_instr_args(c, i, expr_ap_args(e));
+                return;
+            case expr_kind::Box:
+                i.m_op = opcode::Box;
+                i.m_a = static_cast<unsigned>(expr_box_type(e));
+                i.m_b = slot(c, expr_box_obj(e));
+                return;
+            case expr_kind::Unbox:
+                i.m_op = opcode::Unbox;
+                i.m_b = slot(c, expr_unbox_obj(e));
+                return;
+            case expr_kind::Lit:
+                if (lit_val_tag(expr_lit_val(e)) == lit_val_kind::Str) {
+                    i.m_op = opcode::Lit;
+                    // kept alive by `code::m_decl`
+                    i.m_imm = lit_val_str(expr_lit_val(e)).raw();
+                    return;
+                } else {
+                    nat const & n = lit_val_num(expr_lit_val(e));
+                    switch (i.m_type) {
+                        case type::Float:
+                            i.m_op = opcode::Lit;
+                            lean_inc(n.raw());
+                            i.m_imm = value::from_float(lean_float_of_nat(n.raw()));
+                            return;
+                        case type::UInt8:
+                        case type::UInt16:
+                        case type::UInt32:
+                        case type::USize:
+                            i.m_op = opcode::Lit;
+                            i.m_imm = lean_usize_of_nat(n.raw());
+                            return;
+                        case type::UInt64:
+                            i.m_op = opcode::Lit;
+                            i.m_imm = lean_uint64_of_nat(n.raw());
+                            return;
+                        case type::Object:
+                        case type::TObject:
+                            i.m_op = opcode::Lit;
+                            i.m_imm = n.raw();
+                            return;
+                        case type::Irrelevant:
+                            break;
+                    }
+                    break;
+                }
+            case expr_kind::IsShared:
+                i.m_op = opcode::IsShared;
+                i.m_b = slot(c, expr_is_shared_obj(e));
+                return;
+            case expr_kind::IsTaggedPtr:
+                i.m_op = opcode::IsTaggedPtr;
+                i.m_b = slot(c, expr_is_tagged_ptr_obj(e));
+                return;
+            case expr_kind::Reset:
+                slot(c, expr_reset_obj(e));
+                break;
+            case expr_kind::Reuse:
+                slot(c, expr_reuse_obj(e));
+                add_args(c, expr_reuse_args(e));
+                break;
+            case expr_kind::PAp:
+                add_args(c, expr_pap_args(e));
+                break;
+        }
+        // rare and invalid instructions are evaluated by `eval_expr`, which accesses the same stack slots
+        i.m_op = opcode::Expr;
+        i.m_a = c.m_exprs.size();
+        c.m_exprs.push_back(e);
+    }
+
+    /** \brief Append bytecode for `b` to `c`, returning the index of its first instruction. */
+    static unsigned compile(code & c, fn_body const & b0, std::vector<jp_scope_entry> & jps) {
+        unsigned start = c.m_instrs.size();
+        fn_body b = b0;
+        while (true) {
+            instr i {};
+            switch (fn_body_tag(b)) {
+                case fn_body_kind::VDecl: {
+                    expr const & e = fn_body_vdecl_expr(b);
+                    fn_body const & cont = fn_body_vdecl_cont(b);
+                    if (expr_tag(e) == expr_kind::FAp && expr_fap_fun(e) == decl_fun_id(c.m_decl) &&
+                        fn_body_tag(cont) == fn_body_kind::Ret && !arg_is_irrelevant(fn_body_ret_arg(cont)) &&
+                        arg_var_id(fn_body_ret_arg(cont)) == fn_body_vdecl_var(b)) {
+                        i.m_op = opcode::TailCall;
+                        set_instr_args(c, i, expr_fap_args(e));
+                        emit(c, i);
+                        return start;
+                    }
+                    i.m_type = fn_body_vdecl_type(b);
+                    i.m_dst = slot(c, fn_body_vdecl_var(b));
+                    compile_expr(c, i, e);
+                    emit(c, i);
+                    b = cont;
+                    break;
+                }
+                case fn_body_kind::JDecl: {
+                    jps.push_back(jp_scope_entry { fn_body_jdecl_id(b).get_small_value(), fn_body_jdecl_params(b), {} });
+                    // the continuation directly follows the instructions emitted so far
+                    compile(c, fn_body_jdecl_cont(b), jps);
+                    jp_scope_entry jp = std::move(jps.back());
+                    jps.pop_back();
+                    unsigned target = compile(c, fn_body_jdecl_body(b), jps);
+                    for (unsigned j : jp.m_jmps) {
+                        c.m_instrs[j].m_a = target;
+                    }
+                    return start;
+                }
+                case fn_body_kind::Set:
+                    i.m_op = opcode::Set;
+                    i.m_dst = slot(c, fn_body_set_var(b));
+                    i.m_a = fn_body_set_idx(b).get_small_value();
+                    i.m_args = add_args(c, array_ref<arg>({fn_body_set_arg(b)}));
+                    emit(c, i);
+                    b = fn_body_set_cont(b);
+                    break;
+                case fn_body_kind::SetTag:
+                    i.m_op = opcode::SetTag;
+                    i.m_dst = slot(c, fn_body_set_tag_var(b));
+                    i.m_a = fn_body_set_tag_cidx(b).get_small_value();
+                    emit(c, i);
+                    b = fn_body_set_tag_cont(b);
+                    break;
+                case fn_body_kind::USet:
+                    i.m_op = opcode::USet;
+                    i.m_dst = slot(c, fn_body_uset_target(b));
+                    i.m_a = fn_body_uset_idx(b).get_small_value();
+                    i.m_b = slot(c, fn_body_uset_source(b));
+                    emit(c, i);
+                    b = fn_body_uset_cont(b);
+                    break;
+                case fn_body_kind::SSet:
+                    i.m_op = opcode::SSet;
+                    i.m_type = fn_body_sset_type(b);
+                    i.m_dst = slot(c, fn_body_sset_target(b));
+                    i.m_b = slot(c, fn_body_sset_source(b));
+                    i.m_imm = fn_body_sset_idx(b).get_small_value() * sizeof(void *) + fn_body_sset_offset(b).get_small_value();
+                    emit(c, i);
+                    b = fn_body_sset_cont(b);
+                    break;
+                case fn_body_kind::Inc:
+                    i.m_op = opcode::Inc;
+                    i.m_a = fn_body_inc_val(b).get_small_value();
+                    i.m_b = slot(c, fn_body_inc_var(b));
+                    emit(c, i);
+                    b = fn_body_inc_cont(b);
+                    break;
+                case fn_body_kind::Dec:
+                    i.m_op = opcode::Dec;
+                    i.m_a = fn_body_dec_val(b).get_small_value();
+                    i.m_b = slot(c, fn_body_dec_var(b));
+                    emit(c, i);
+                    b = fn_body_dec_cont(b);
+                    break;
+                case fn_body_kind::Del:
+                    i.m_op = opcode::Del;
+                    i.m_b = slot(c, fn_body_del_var(b));
+                    emit(c, i);
+                    b = fn_body_del_cont(b);
+                    break;
+                case fn_body_kind::MData:
+                    b = fn_body_mdata_cont(b);
+                    break;
+                case fn_body_kind::Case: {
+                    array_ref<alt_core> const & alts = fn_body_case_alts(b);
+                    unsigned num_tags = 0;
+                    for (alt_core const & a : alts) {
+                        if (alt_core_tag(a) == alt_core_kind::Ctor) {
+                            num_tags = std::max(num_tags, static_cast<unsigned>(ctor_info_tag(alt_core_ctor_info(a)).get_small_value()) + 1);
+                        }
+                    }
+                    i.m_op = opcode::Case;
+                    i.m_type = fn_body_case_var_type(b);
+                    i.m_b = slot(c, fn_body_case_var(b));
+                    i.m_a = c.m_case_targets.size();
+                    i.m_num_args = num_tags;
+                    c.m_case_targets.resize(c.m_case_targets.size() + num_tags + 1, g_no_target);
+                    emit(c, i);
+                    unsigned table = i.m_a;
+                    bool has_default = false;
+                    for (alt_core const & a : alts) {
+                        if (has_default) {
+                            break;
+                        }
+                        switch (alt_core_tag(a)) {
+                            case alt_core_kind::Ctor: {
+                                unsigned tag = ctor_info_tag(alt_core_ctor_info(a)).get_small_value();
+                                // the first matching alternative wins
+                                if (c.m_case_targets[table + tag] == g_no_target) {
+                                    c.m_case_targets[table + tag] = compile(c, alt_core_ctor_cont(a), jps);
+                                }
+                                break;
+                            }
+                            case alt_core_kind::Default: {
+                                unsigned target = compile(c, alt_core_default_cont(a), jps);
+                                for (unsigned t = 0; t <= num_tags; t++) {
+                                    if (c.m_case_targets[table + t] == g_no_target) {
+                                        c.m_case_targets[table + t] = target;
+                                    }
+                                }
+                                has_default = true;
+                                break;
+                            }
+                        }
+                    }
+                    return start;
+                }
+                case fn_body_kind::Ret:
+                    i.m_op = opcode::Ret;
+                    i.m_args = add_args(c, array_ref<arg>({fn_body_ret_arg(b)}));
+                    emit(c, i);
+                    return start;
+                case fn_body_kind::Jmp: {
+                    size_t id = fn_body_jmp_jp(b).get_small_value();
+                    auto jp = jps.rbegin();
+                    while (jp != jps.rend() && jp->m_id != id) {
+                        ++jp;
+                    }
+                    if (jp == jps.rend()) {
+                        throw exception(sstream() << "unknown join point in '" << decl_fun_id(c.m_decl) << "'");
+                    }
+                    i.m_op = opcode::Jmp;
+                    i.m_a = g_no_target;
+                    set_instr_args(c, i, fn_body_jmp_args(b));
+                    for (param const & p : jp->m_params) {
+                        c.m_args.push_back(slot(c, param_var(p)));
+                    }
+                    jp->m_jmps.push_back(emit(c, i));
+                    return start;
+                }
+                case fn_body_kind::Unreachable:
+                    i.m_op = opcode::Unreachable;
+                    emit(c, i);
+                    return start;
+            }
+        }
+    }
+
+    /** \brief Resolve callee on first use. */
+    void resolve(callee & ce) {
+        ce.m_sym = lookup_symbol(ce.m_fn);
+        if (!ce.m_sym.m_addr && decl_tag(ce.m_sym.m_decl) == decl_kind::Fun) {
+            ce.m_code = &get_code(ce.m_sym.m_decl);
+        }
+        ce.m_resolved = true;
+    }
+
+    /** \brief Execute bytecode in the current stack frame, which already contains the arguments. */
+    value run(code & c) {
+        check_system();
+        size_t bp = get_frame().m_arg_bp;
+        if (m_arg_stack.size() < bp + c.m_frame_size) {
+            m_arg_stack.resize(bp + c.m_frame_size);
+        }
+        // NOTE: must be reloaded after anything that may call back into the interpreter and thus grow the stack
+        value * fp = m_arg_stack.data() + bp;
+        auto arg = [&](unsigned s) { return s == g_irrelevant_slot ? value(box(0)) : fp[s]; };
+        unsigned pc = 0;
+        while (true) {
+            instr const & i = c.m_instrs[pc++];
+            switch (i.m_op) {
+                case opcode::Ctor: {
+                    object * o = alloc_cnstr(i.m_imm.m_num, i.m_a, i.m_b);
+                    for (unsigned j = 0; j < i.m_num_args; j++) {
+                        cnstr_set(o, j, arg(c.m_args[i.m_args + j]).m_obj);
+                    }
+                    fp[i.m_dst] = o;
+                    break;
+                }
+                case opcode::Proj:
+                    fp[i.m_dst] = cnstr_get(fp[i.m_b].m_obj, i.m_a);
+                    break;
+                case opcode::UProj:
+                    fp[i.m_dst] = cnstr_get_usize(fp[i.m_b].m_obj, i.m_a);
+                    break;
+                case opcode::SProj: {
+                    object * o = fp[i.m_b].m_obj;
+                    size_t offset = i.m_imm.m_num;
+                    switch (i.m_type) {
+                        case type::Float: fp[i.m_dst] = value::from_float(cnstr_get_float(o, offset)); break;
+                        case type::UInt8: fp[i.m_dst] = cnstr_get_uint8(o, offset); break;
+                        case type::UInt16: fp[i.m_dst] = cnstr_get_uint16(o, offset); break;
+                        case type::UInt32: fp[i.m_dst] = cnstr_get_uint32(o, offset); break;
+                        default: fp[i.m_dst] = cnstr_get_uint64(o, offset); break; // checked by `compile_expr`
+                    }
+                    break;
+                }
+                case opcode::Call: {
+                    callee & ce = c.m_callees[i.m_a];
+                    if (!ce.m_resolved) {
+                        resolve(ce);
+                    }
+                    value * args = static_cast<value *>(LEAN_ALLOCA(i.m_num_args * sizeof(value))); // NOLINT
+                    for (unsigned j = 0; j < i.m_num_args; j++) {
+                        args[j] = arg(c.m_args[i.m_args + j]);
+                    }
+                    value r = call(ce.m_fn, ce.m_sym, args, i.m_num_args, ce.m_code);
+                    fp = m_arg_stack.data() + bp;
+                    fp[i.m_dst] = r;
+                    break;
+                }
+                case opcode::Const: {
+                    callee & ce = c.m_callees[i.m_a];
+                    value r;
+                    if (ce.m_const_cached) {
+                        r = ce.m_const.m_val;
+                        if (!ce.m_const.m_is_scalar) {
+                            inc(r.m_obj);
+                        }
+                    } else {
+                        r = load(ce.m_fn, i.m_type);
+                        fp = m_arg_stack.data() + bp;
+                        if (constant_cache_entry const * e = m_constant_cache.find(ce.m_fn)) {
+                            ce.m_const = *e;
+                            ce.m_const_cached = true;
+                        } else if (object * const * o = g_init_globals->find(ce.m_fn)) {
+                            // persistent, so treat like a scalar
+                            ce.m_const = constant_cache_entry { true, *o };
+                            ce.m_const_cached = true;
+                        }
+                    }
+                    fp[i.m_dst] = r;
+                    break;
+                }
+                case opcode::Ap: {
+                    object ** args = static_cast<object **>(LEAN_ALLOCA(i.m_num_args * sizeof(object *))); // NOLINT
+                    for (unsigned j = 0; j < i.m_num_args; j++) {
+                        args[j] = arg(c.m_args[i.m_args + j]).m_obj;
+                    }
+                    object * r = apply_n(fp[i.m_b].m_obj, i.m_num_args, args);
+                    fp = m_arg_stack.data() + bp;
+                    fp[i.m_dst] = r;
+                    break;
+                }
+                case opcode::Box:
+                    fp[i.m_dst] = box_t(fp[i.m_b], static_cast<type>(i.m_a));
+                    break;
+                case opcode::Unbox:
+                    fp[i.m_dst] = unbox_t(fp[i.m_b].m_obj, i.m_type);
+                    break;
+                case opcode::Lit:
+                    if (!type_is_scalar(i.m_type)) {
+                        inc(i.m_imm.m_obj);
+                    }
+                    fp[i.m_dst] = i.m_imm;
+                    break;
+                case opcode::IsShared:
+                    fp[i.m_dst] = !is_exclusive(fp[i.m_b].m_obj);
+                    break;
+                case opcode::IsTaggedPtr:
+                    fp[i.m_dst] = !is_scalar(fp[i.m_b].m_obj);
+                    break;
+                case opcode::Expr: {
+                    value r = eval_expr(c.m_exprs[i.m_a], i.m_type);
+                    fp = m_arg_stack.data() + bp;
+                    fp[i.m_dst] = r;
+                    break;
+                }
+                case opcode::Set:
+                    lean_assert(is_exclusive(fp[i.m_dst].m_obj));
+                    cnstr_set(fp[i.m_dst].m_obj, i.m_a, arg(c.m_args[i.m_args]).m_obj);
+                    break;
+                case opcode::SetTag:
+                    lean_assert(is_exclusive(fp[i.m_dst].m_obj));
+                    cnstr_set_tag(fp[i.m_dst].m_obj, i.m_a);
+                    break;
+                case opcode::USet:
+                    lean_assert(is_exclusive(fp[i.m_dst].m_obj));
+                    cnstr_set_usize(fp[i.m_dst].m_obj, i.m_a, fp[i.m_b].m_num);
+                    break;
+                case opcode::SSet: {
+                    object * o = fp[i.m_dst].m_obj;
+                    size_t offset = i.m_imm.m_num;
+                    value v = fp[i.m_b];
+                    lean_assert(is_exclusive(o));
+                    switch (i.m_type) {
+                        case type::Float: cnstr_set_float(o, offset, v.m_float); break;
+                        case type::UInt8: cnstr_set_uint8(o, offset, v.m_num); break;
+                        case type::UInt16: cnstr_set_uint16(o, offset, v.m_num); break;
+                        case type::UInt32: cnstr_set_uint32(o, offset, v.m_num); break;
+                        case type::UInt64: cnstr_set_uint64(o, offset, v.m_num); break;
+                        case type::USize:
+                        case type::Irrelevant:
+                        case type::Object:
+                        case type::TObject:
+                            throw exception(sstream() << "invalid instruction");
+                    }
+                    break;
+                }
+                case opcode::Inc:
+                    inc(fp[i.m_b].m_obj, i.m_a);
+                    break;
+                case opcode::Dec:
+                    for (unsigned j = 0; j < i.m_a; j++) {
+                        dec(fp[i.m_b].m_obj);
+                    }
+                    break;
+                case opcode::Del:
+                    lean_free_object(fp[i.m_b].m_obj);
+                    break;
+                case opcode::Case: {
+                    value v = fp[i.m_b];
+                    unsigned tag = type_is_scalar(i.m_type) ? v.m_num : lean_obj_tag(v.m_obj);
+                    unsigned target = c.m_case_targets[i.m_a + std::min(tag, i.m_num_args)];
+                    if (target == g_no_target) {
+                        throw exception("incomplete case");
+                    }
+                    pc = target;
+                    break;
+                }
+                case opcode::Ret:
+                    return arg(c.m_args[i.m_args]);
+                case opcode::Jmp:
+                case opcode::TailCall: {
+                    // arguments and parameter slots may overlap, so first copy arguments
+                    value * args = static_cast<value *>(LEAN_ALLOCA(i.m_num_args * sizeof(value))); // NOLINT
+                    for (unsigned j = 0; j < i.m_num_args; j++) {
+                        args[j] = arg(c.m_args[i.m_args + j]);
+                    }
+                    if (i.m_op == opcode::Jmp) {
+                        for (unsigned j = 0; j < i.m_num_args; j++) {
+                            fp[c.m_args[i.m_args + i.m_num_args + j]] = args[j];
+                        }
+                        pc = i.m_a;
+                    } else {
+                        for (unsigned j = 0; j < i.m_num_args; j++) {
+                            fp[j] = args[j];
+                        }
+                        pc = 0;
+                        check_system();
+                    }
+                    break;
+                }
+                case opcode::Unreachable:
+                    throw exception("unreachable code");
+            }
+        }
+    }
+
     // specify argument base pointer explicitly because we've usually already pushed some function arguments
-    void push_frame(decl const & d, size_t arg_bp) {
+    void push_frame(decl const & d, size_t arg_bp, bool native = false) {
         DEBUG_CODE({
             lean_trace(name({"interpreter", "call"}),
                        tout() << std::string(m_call_stack.size(), ' ')
@@ -732,9 +1479,26 @@ private:
                        tout() << "\n";);
         });
         m_call_stack.emplace_back(decl_fun_id(d), arg_bp, m_jp_stack.size());
+        if (m_profile_root) {
+            frame & f = get_frame();
+            f.m_prof = get_profile_parent()->get_callee(f.m_fn, native);
+            f.m_prof_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    profile_node * get_profile_parent() {
+        return m_call_stack.size() > 1 ? m_call_stack[m_call_stack.size() - 2].m_prof : m_profile_root.get();
     }
 
     void pop_frame(value DEBUG_CODE(r), type DEBUG_CODE(t)) {
+        if (m_profile_root) {
+            frame const & f = get_frame();
+            uint64 elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - f.m_prof_start).count();
+            f.m_prof->m_calls++;
+            f.m_prof->m_inclusive += elapsed;
+            get_profile_parent()->m_callees_time += elapsed;
+        }
         m_arg_stack.resize(get_frame().m_arg_bp);
         m_jp_stack.resize(get_frame().m_jp_bp);
         m_call_stack.pop_back();
@@ -753,6 +1517,20 @@ private:
             return *e;
         } else {
             symbol_cache_entry e_new { get_decl(fn), nullptr, false };
+            {
+                lock_guard<mutex> lock(g_shared_caches->m_mutex);
+                name_map<symbol_cache_entry> & symbols = g_shared_caches->m_symbols[m_prefer_native];
+                if (symbol_cache_entry const * e = symbols.find(fn)) {
+                    if (e->m_decl.raw() == e_new.m_decl.raw()) {
+                        g_shared_caches->m_num_hits++;
+                        e_new = *e;
+                        m_symbol_cache.insert(fn, e_new);
+                        return e_new;
+                    }
+                    symbols.erase(fn);
+                }
+            }
+            bool found = true;
             if (m_prefer_native || decl_tag(e_new.m_decl) == decl_kind::Extern || has_init_attribute(m_env, fn)) {
                 string_ref mangled = name_mangle(fn, *g_mangle_prefix);
                 string_ref boxed_mangled(string_append(mangled.to_obj_arg(), g_boxed_mangled_suffix->raw()));
@@ -763,9 +1541,16 @@ private:
                 } else if (void *p = lookup_symbol_in_cur_exe(mangled.data())) {
                     // if there is no boxed version, there are no unboxed parameters, so use default version
                     e_new.m_addr = p;
+                } else {
+                    found = false;
                 }
             }
             m_symbol_cache.insert(fn, e_new);
+            if (found) {
+                mark_mt(e_new.m_decl.raw());
+                lock_guard<mutex> lock(g_shared_caches->m_mutex);
+                insert_shared(g_shared_caches->m_symbols[m_prefer_native], fn, e_new);
+            }
             return e_new;
         }
     }
@@ -816,25 +1601,55 @@ private:
             // We don't know whether `[init]` decls can be re-executed, so let's not.
             throw exception(sstream() << "cannot evaluate `[init]` declaration '" << fn << "' in the same module");
         }
+        {
+            lock_guard<mutex> lock(g_shared_caches->m_mutex);
+            if (shared_constant_entry const * c = g_shared_caches->m_constants.find(fn)) {
+                if (c->m_decl.raw() == e.m_decl.raw()) {
+                    g_shared_caches->m_num_hits++;
+                    if (!c->m_is_scalar) {
+                        // one reference for the local cache, one for the result
+                        inc(c->m_val.m_obj, 2);
+                    }
+                    m_constant_cache.insert(fn, constant_cache_entry { c->m_is_scalar, c->m_val });
+                    return c->m_val;
+                }
+                g_shared_caches->m_constants.erase(fn);
+            }
+        }
         push_frame(e.m_decl, m_arg_stack.size());
-        value r = eval_body(decl_fun_body(e.m_decl));
+        value r = eval_decl(e.m_decl);
         pop_frame(r, decl_type(e.m_decl));
         if (!type_is_scalar(t)) {
             inc(r.m_obj);
+            mark_mt(r.m_obj);
         }
         m_constant_cache.insert(fn, constant_cache_entry { type_is_scalar(t), r });
+        mark_mt(e.m_decl.raw());
+        shared_constant_entry c { e.m_decl, type_is_scalar(t), r,
+                                  type_is_scalar(t) ? object_ref() : object_ref(r.m_obj, true) };
+        lock_guard<mutex> lock(g_shared_caches->m_mutex);
+        insert_shared(g_shared_caches->m_constants, fn, c);
         return r;
     }
 
     value call(name const & fn, array_ref<arg> const & args) {
+        symbol_cache_entry e = lookup_symbol(fn);
+        value * vals = static_cast<value *>(LEAN_ALLOCA(args.size() * sizeof(value))); // NOLINT
+        for (size_t i = 0; i < args.size(); i++) {
+            vals[i] = eval_arg(args[i]);
+        }
+        return call(fn, e, vals, args.size(), nullptr);
+    }
+
+    /** \brief Call resolved function with given argument values. If `cd` is not null, it is the bytecode of `fn`. */
+    value call(name const & fn, symbol_cache_entry const & e, value const * args, size_t num_args, code * cd) {
         size_t old_size = m_arg_stack.size();
         value r;
-        symbol_cache_entry e = lookup_symbol(fn);
         if (e.m_addr) {
-            object ** args2 = static_cast<object **>(LEAN_ALLOCA(args.size() * sizeof(object *))); // NOLINT
-            for (size_t i = 0; i < args.size(); i++) {
+            object ** args2 = static_cast<object **>(LEAN_ALLOCA(num_args * sizeof(object *))); // NOLINT
+            for (size_t i = 0; i < num_args; i++) {
                 type t = param_type(decl_params(e.m_decl)[i]);
-                args2[i] = box_t(eval_arg(args[i]), t);
+                args2[i] = box_t(args[i], t);
                 if (e.m_boxed && param_borrow(decl_params(e.m_decl)[i])) {
                     // NOTE: If we chose the boxed version where the IR chose the unboxed one, we need to manually increment
                     // originally borrowed parameters because the wrapper will decrement these after the call.
@@ -843,8 +1658,8 @@ private:
                     inc(args2[i]);
                 }
             }
-            push_frame(e.m_decl, old_size);
-            object * o = curry(e.m_addr, args.size(), args2);
+            push_frame(e.m_decl, old_size, /* native */ true);
+            object * o = curry(e.m_addr, num_args, args2);
             type t = decl_type(e.m_decl);
             if (type_is_scalar(t)) {
                 lean_assert(e.m_boxed);
@@ -861,12 +1676,11 @@ private:
                 throw exception(sstream() << "could not find native implementation of external declaration '" << fn
                                           << "' (symbols '" << boxed_mangled.data() << "' or '" << mangled.data() << "')");
             }
-            // evaluate args in old stack frame
-            for (const auto & arg : args) {
-                m_arg_stack.push_back(eval_arg(arg));
+            for (size_t i = 0; i < num_args; i++) {
+                m_arg_stack.push_back(args[i]);
             }
             push_frame(e.m_decl, old_size);
-            r = eval_body(decl_fun_body(e.m_decl));
+            r = cd ? run(*cd) : eval_decl(e.m_decl);
         }
         pop_frame(r, decl_type(e.m_decl));
         return r;
@@ -880,7 +1694,7 @@ private:
             m_arg_stack.push_back(args[3 + i]);
         }
         push_frame(d, old_size);
-        object * r = eval_body(decl_fun_body(d)).m_obj;
+        object * r = eval_decl(d).m_obj;
         pop_frame(r, type::TObject);
         return r;
     }
@@ -937,9 +1751,24 @@ private:
 public:
     explicit interpreter(environment const & env, options const & opts) : m_env(env), m_opts(opts) {
         m_prefer_native = opts.get_bool(*g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE);
+        m_bytecode = opts.get_bool(*g_interpreter_bytecode, LEAN_DEFAULT_INTERPRETER_BYTECODE);
+        m_profile_file = opts.get_string(*g_interpreter_profile, "");
+        if (!m_profile_file.empty()) {
+            m_profile_root.reset(new profile_node(name(), false));
+            if (g_interpreter) {
+                // `with_interpreter` has not yet replaced the enclosing interpreter
+                for (frame const & f : g_interpreter->m_call_stack) {
+                    m_profile_prefix += profile_frame_name(f.m_fn, false) + ";";
+                }
+            }
+        }
     }
 
     ~interpreter() {
+        if (m_profile_root) {
+            write_profile();
+            free_profile();
+        }
         for_each(m_constant_cache, [](name const &, constant_cache_entry const & e) {
             if (!e.m_is_scalar) {
                 dec(e.m_val.m_obj);
@@ -947,6 +1776,111 @@ public:
         });
     }
 
+    static std::string profile_frame_name(name const & fn, bool native) {
+        std::string r = fn.to_string();
+        // `;` separates frames in the folded format
+        std::replace(r.begin(), r.end(), ';', ':');
+        return native ? r + " [native]" : r;
+    }
+
+    struct profile_totals {
+        uint64 m_calls = 0;
+        uint64 m_inclusive = 0;
+        uint64 m_exclusive = 0;
+        // number of occurrences on the current path, used to count inclusive time of recursive calls only once
+        unsigned m_on_path = 0;
+    };
+
+    void write_profile() {
+        // frame names interned per (function, native) pair; `totals` is indexed by the same ids
+        name_map<unsigned> ids[2];
+        std::vector<std::string> names;
+        std::vector<profile_totals> totals;
+        auto intern = [&](profile_node const & n) {
+            if (unsigned const * id = ids[n.m_native].find(n.m_fn)) {
+                return *id;
+            }
+            unsigned id = names.size();
+            ids[n.m_native].insert(n.m_fn, id);
+            names.push_back(profile_frame_name(n.m_fn, n.m_native));
+            totals.emplace_back();
+            return id;
+        };
+        std::ostringstream folded;
+        // explicit DFS stack of nodes, the index of their next callee to visit, and their interned name; the call tree is
+        // as deep as the deepest interpreted recursion, so we must not recurse here
+        struct entry {
+            profile_node const * m_node;
+            size_t               m_next;
+            unsigned             m_id;
+        };
+        std::vector<entry> path;
+        for (auto const & root : m_profile_root->m_callees) {
+            path.push_back(entry { root.get(), 0, intern(*root) });
+            totals[path.back().m_id].m_on_path++;
+            while (!path.empty()) {
+                entry & e = path.back();
+                profile_node const & n = *e.m_node;
+                if (e.m_next == 0) {
+                    // first visit
+                    profile_totals & t = totals[e.m_id];
+                    uint64 exclusive = n.m_inclusive > n.m_callees_time ? n.m_inclusive - n.m_callees_time : 0;
+                    if (exclusive >= 1000) {
+                        folded << m_profile_prefix;
+                        for (size_t i = 0; i < path.size(); i++) {
+                            folded << (i > 0 ? ";" : "") << names[path[i].m_id];
+                        }
+                        folded << " " << exclusive / 1000 << "\n";
+                    }
+                    t.m_calls += n.m_calls;
+                    t.m_exclusive += exclusive;
+                    if (t.m_on_path == 1) {
+                        t.m_inclusive += n.m_inclusive;
+                    }
+                }
+                if (e.m_next < n.m_callees.size()) {
+                    profile_node const & c = *n.m_callees[e.m_next++];
+                    unsigned id = intern(c);
+                    // `e` may be invalidated by `push_back`
+                    path.push_back(entry { &c, 0, id });
+                    totals[id].m_on_path++;
+                } else {
+                    totals[e.m_id].m_on_path--;
+                    path.pop_back();
+                }
+            }
+        }
+        std::vector<unsigned> fns(names.size());
+        for (unsigned i = 0; i < fns.size(); i++) {
+            fns[i] = i;
+        }
+        std::sort(fns.begin(), fns.end(), [&](unsigned a, unsigned b) {
+            return totals[a].m_exclusive > totals[b].m_exclusive;
+        });
+        lock_guard<mutex> lock(*g_interpreter_profile_mutex);
+        std::ofstream out(m_profile_file, std::ios::app);
+        out << folded.str();
+        std::ofstream out_fns(m_profile_file + ".functions", std::ios::app);
+        for (unsigned i : fns) {
+            profile_totals const & t = totals[i];
+            out_fns << names[i] << "\t" << t.m_calls << " calls\t" << t.m_inclusive / 1000 << "us inclusive\t"
+                    << t.m_exclusive / 1000 << "us exclusive\n";
+        }
+    }
+
+    /** \brief Free the call tree without recursing, see `write_profile`. */
+    void free_profile() {
+        std::vector<std::unique_ptr<profile_node>> todo;
+        todo.push_back(std::move(m_profile_root));
+        while (!todo.empty()) {
+            std::unique_ptr<profile_node> n = std::move(todo.back());
+            todo.pop_back();
+            for (auto & c : n->m_callees) {
+                todo.push_back(std::move(c));
+            }
+        }
+    }
+
     /** A variant of `call` designed for external uses.
      *  * takes (owned) `object *`s instead of `arg`s.
      *  * supports under- and over-application.
@@ -1042,6 +1976,8 @@ public:
     }
 };
 
+interpreter::shared_caches * interpreter::g_shared_caches = nullptr;
+
 extern "C" object * lean_decl_get_sorry_dep(object * env, object * n);
 
 optional<name> get_sorry_dep(environment const & env, name const & n) {
@@ -1067,6 +2003,11 @@ extern "C" LEAN_EXPORT object * lean_eval_const(object * env, object * opts, obj
     }
 }
 
+/* getInterpreterSharedCacheHits : BaseIO Nat */
+extern "C" LEAN_EXPORT obj_res lean_get_interpreter_shared_cache_hits(obj_arg) {
+    return lean_io_result_mk_ok(lean_usize_to_nat(ir::interpreter::get_shared_cache_hits()));
+}
+
 /* mkModuleInitializationFunctionName (moduleName : Name) : String */
 extern "C" obj_res lean_mk_module_initialization_function_name(obj_arg);
 
@@ -1102,8 +2043,15 @@ void initialize_ir_interpreter() {
     ir::g_boxed_mangled_suffix = new string_ref("___boxed");
     mark_persistent(ir::g_boxed_mangled_suffix->raw());
     ir::g_interpreter_prefer_native = new name({"interpreter", "prefer_native"});
+    ir::g_interpreter_bytecode = new name({"interpreter", "bytecode"});
+    ir::g_interpreter_profile = new name({"interpreter", "profile"});
+    ir::g_interpreter_profile_mutex = new mutex();
     ir::g_init_globals = new name_map<object *>();
+    ir::interpreter::initialize_shared_caches();
+    set_alloc_sampler_frames_fn(ir::interpreter::get_alloc_sampler_frames);
     register_bool_option(*ir::g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE, "(interpreter) whether to use precompiled code where available");
+    register_bool_option(*ir::g_interpreter_bytecode, LEAN_DEFAULT_INTERPRETER_BYTECODE, "(interpreter) whether to lower interpreted declarations to bytecode instead of walking their IR");
+    register_option(*ir::g_interpreter_profile, data_value_kind::String, "", "(interpreter) if not empty, append folded call stacks with the time spent in interpreted and native calls to this file");
     DEBUG_CODE({
         register_trace_class({"interpreter"});
         register_trace_class({"interpreter", "call"});
@@ -1112,7 +2060,12 @@ void initialize_ir_interpreter() {
 }
 
 void finalize_ir_interpreter() {
+    set_alloc_sampler_frames_fn(nullptr);
+    ir::interpreter::finalize_shared_caches();
     delete ir::g_init_globals;
+    delete ir::g_interpreter_profile_mutex;
+    delete ir::g_interpreter_profile;
+    delete ir::g_interpreter_bytecode;
     delete ir::g_interpreter_prefer_native;
     delete ir::g_boxed_mangled_suffix;
     delete ir::g_boxed_suffix;
@@ -14,6 +14,7 @@ Author: Leonardo de Moura
 #include "library/trace.h"
 #include "library/compiler/util.h"
 #include "library/compiler/csimp.h"
+#include "library/compiler/specialize.h"
 
 namespace lean {
 extern "C" uint8 lean_has_specialize_attribute(object* env, object* n);
@@ -263,9 +264,43 @@ static optional<name> get_cached_specialization(environment const & env, expr co
     return to_optional<name>(lean_get_cached_specialization(env.to_obj_arg(), e.to_obj_arg()));
 }
 
+/* Rename the universe level parameters occurring in the cache key `e` to `_u_1`, `_u_2`, ... in order of first
+   occurrence. A specialization performed in a universe polymorphic declaration is valid for every instantiation of
+   its universe parameters, so it can be reused by other declarations and downstream modules that differ only in
+   the names of these parameters. Concrete levels are preserved: for example, a key instantiated with `Sort 0`
+   (i.e., `Prop`) does not share an entry with the polymorphic one, since the erasure of `Prop` values depends on them. */
+static expr canonicalize_univ_params(expr const & e) {
+    if (!has_univ_param(e)) return e;
+    buffer<name> ps;
+    auto collect = [&](level const & l) {
+        for_each(l, [&](level const & l) {
+                if (!has_param(l)) return false;
+                if (is_param(l) && std::find(ps.begin(), ps.end(), param_id(l)) == ps.end())
+                    ps.push_back(param_id(l));
+                return true;
+            });
+    };
+    for_each(e, [&](expr const & e, unsigned) {
+            if (!has_univ_param(e)) {
+                return false;
+            } else if (is_constant(e)) {
+                for (level const & l : const_levels(e))
+                    collect(l);
+            } else if (is_sort(e)) {
+                collect(sort_level(e));
+            }
+            return true;
+        });
+    buffer<level> ls;
+    for (unsigned i = 0; i < ps.size(); i++)
+        ls.push_back(mk_univ_param(name("_u").append_after(i + 1)));
+    return instantiate_lparams(e, names(ps), levels(ls));
+}
+
 class specialize_fn {
     type_checker::state m_st;
     csimp_cfg           m_cfg;
+    spec_cache_stats &  m_stats;
     local_ctx           m_lctx;
     buffer<comp_decl>   m_new_decls;
     name                m_base_name;
@@ -990,7 +1025,6 @@ class specialize_fn {
     }
 
     optional<expr> get_closed(expr const & e) {
-        if (has_univ_param(e)) return none_expr();
         switch (e.kind()) {
         case expr_kind::MVar:  lean_unreachable();
         case expr_kind::Lit:   return some_expr(e);
@@ -1114,7 +1148,7 @@ class specialize_fn {
            This file will be deleted. So, it is not worth designing a better caching scheme.
            TODO: when we reimplement this module in Lean, we should have a better caching heuristic. */
         if (gcache_enabled && ctx.m_params.size() == 0) {
-            key = mk_app(fn, gcache_key_args);
+            key = canonicalize_univ_params(mk_app(fn, gcache_key_args));
             if (optional<name> it = get_cached_specialization(env(), key)) {
                 lean_trace(name({"compiler", "specialize"}), tout() << "get_cached_specialization [" << ctx.m_params.size() << "]: " << *it << "\n";
                            unsigned i = 0;
@@ -1126,6 +1160,7 @@ class specialize_fn {
                            tout() << ">> key: " << trace_pp_expr(key) << "\n";);
                 // std::cerr << *it << " " << ctx.m_vars.size() << " " << ctx.m_params.size() << "\n";
                 new_fn_name = *it;
+                m_stats.m_hits++;
             }
         }
         if (!new_fn_name) {
@@ -1163,6 +1198,9 @@ class specialize_fn {
                            }
                            tout()  << ">> key: " << trace_pp_expr(key) << "\n";);
                 m_st.env() = cache_specialization(env(), key, *new_fn_name);
+                m_stats.m_misses++;
+            } else {
+                m_stats.m_uncached++;
             }
         }
         expr r = mk_constant(*new_fn_name);
@@ -1213,8 +1251,8 @@ class specialize_fn {
     }
 
 public:
-    specialize_fn(environment const & env, csimp_cfg const & cfg):
-        m_st(env), m_cfg(cfg), m_at("_at"), m_spec("_spec") {}
+    specialize_fn(environment const & env, csimp_cfg const & cfg, spec_cache_stats & stats):
+        m_st(env), m_cfg(cfg), m_stats(stats), m_at("_at"), m_spec("_spec") {}
 
     pair<environment, comp_decls> operator()(comp_decl const & d) {
         m_base_name = d.fst();
@@ -1225,11 +1263,12 @@ public:
     }
 };
 
-pair<environment, comp_decls> specialize_core(environment const & env, comp_decl const & d, csimp_cfg const & cfg) {
-    return specialize_fn(env, cfg)(d);
+pair<environment, comp_decls> specialize_core(environment const & env, comp_decl const & d, csimp_cfg const & cfg,
+                                              spec_cache_stats & stats) {
+    return specialize_fn(env, cfg, stats)(d);
 }
 
-pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg) {
+pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg, spec_cache_stats & stats) {
     env = update_spec_info(env, ds);
     comp_decls r;
     for (comp_decl const & d : ds) {
@@ -1237,7 +1276,7 @@ pair<environment, comp_decls> specialize(environment env, comp_decls const & ds,
         if (has_specialize_attribute(env, d.fst())) {
             r = append(r, comp_decls(d));
         } else {
-            std::tie(env, new_ds) = specialize_core(env, d, cfg);
+            std::tie(env, new_ds) = specialize_core(env, d, cfg, stats);
             r = append(r, new_ds);
         }
     }
@@ -9,7 +9,13 @@ Author: Leonardo de Moura
 #include "library/compiler/util.h"
 #include "library/compiler/csimp.h"
 namespace lean {
-pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg);
+/* Statistics about the specialization cache, see `cache_specialization`. */
+struct spec_cache_stats {
+    unsigned m_hits{0};      // specializations reused from the cache, including the ones of imported modules
+    unsigned m_misses{0};    // new specializations added to the cache
+    unsigned m_uncached{0};  // new specializations that cannot be cached
+};
+pair<environment, comp_decls> specialize(environment env, comp_decls const & ds, csimp_cfg const & cfg, spec_cache_stats & stats);
 void initialize_specialize();
 void finalize_specialize();
 }
@@ -105,8 +105,14 @@ name const * g_unit = nullptr;
 name const * g_unit_unit = nullptr;
 name const * g_uint8 = nullptr;
 name const * g_uint16 = nullptr;
+name const * g_uint16_array = nullptr;
+name const * g_uint16_array_data = nullptr;
 name const * g_uint32 = nullptr;
+name const * g_uint32_array = nullptr;
+name const * g_uint32_array_data = nullptr;
 name const * g_uint64 = nullptr;
+name const * g_uint64_array = nullptr;
+name const * g_uint64_array_data = nullptr;
 name const * g_usize = nullptr;
 void initialize_constants() {
     g_absurd = new name{"absurd"};
@@ -313,10 +319,22 @@ void initialize_constants() {
     mark_persistent(g_uint8->raw());
     g_uint16 = new name{"UInt16"};
     mark_persistent(g_uint16->raw());
+    g_uint16_array = new name{"UInt16Array"};
+    mark_persistent(g_uint16_array->raw());
+    g_uint16_array_data = new name{"UInt16Array", "data"};
+    mark_persistent(g_uint16_array_data->raw());
     g_uint32 = new name{"UInt32"};
     mark_persistent(g_uint32->raw());
+    g_uint32_array = new name{"UInt32Array"};
+    mark_persistent(g_uint32_array->raw());
+    g_uint32_array_data = new name{"UInt32Array", "data"};
+    mark_persistent(g_uint32_array_data->raw());
     g_uint64 = new name{"UInt64"};
     mark_persistent(g_uint64->raw());
+    g_uint64_array = new name{"UInt64Array"};
+    mark_persistent(g_uint64_array->raw());
+    g_uint64_array_data = new name{"UInt64Array", "data"};
+    mark_persistent(g_uint64_array_data->raw());
     g_usize = new name{"USize"};
     mark_persistent(g_usize->raw());
 }
@@ -423,8 +441,14 @@ void finalize_constants() {
     delete g_unit_unit;
     delete g_uint8;
     delete g_uint16;
+    delete g_uint16_array;
+    delete g_uint16_array_data;
     delete g_uint32;
+    delete g_uint32_array;
+    delete g_uint32_array_data;
     delete g_uint64;
+    delete g_uint64_array;
+    delete g_uint64_array_data;
     delete g_usize;
 }
 name const & get_absurd_name() { return *g_absurd; }
@@ -529,7 +553,13 @@ name const & get_unit_name() { return *g_unit; }
 name const & get_unit_unit_name() { return *g_unit_unit; }
 name const & get_uint8_name() { return *g_uint8; }
 name const & get_uint16_name() { return *g_uint16; }
+name const & get_uint16_array_name() { return *g_uint16_array; }
+name const & get_uint16_array_data_name() { return *g_uint16_array_data; }
 name const & get_uint32_name() { return *g_uint32; }
+name const & get_uint32_array_name() { return *g_uint32_array; }
+name const & get_uint32_array_data_name() { return *g_uint32_array_data; }
 name const & get_uint64_name() { return *g_uint64; }
+name const & get_uint64_array_name() { return *g_uint64_array; }
+name const & get_uint64_array_data_name() { return *g_uint64_array_data; }
 name const & get_usize_name() { return *g_usize; }
 }
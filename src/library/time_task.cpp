@@ -12,6 +12,7 @@ Author: Sebastian Ullrich
 namespace lean {
 
 static std::map<std::string, second_duration> * g_cum_times;
+static std::map<std::string, uint64> * g_cum_counters;
 static mutex * g_cum_times_mutex;
 LEAN_THREAD_PTR(time_task, g_current_time_task);
 
@@ -20,20 +21,32 @@ void report_profiling_time(std::string const & category, second_duration time) {
     (*g_cum_times)[category] += time;
 }
 
+void report_profiling_counter(std::string const & category, uint64 n) {
+    lock_guard<mutex> _(*g_cum_times_mutex);
+    (*g_cum_counters)[category] += n;
+}
+
 void display_cumulative_profiling_times(std::ostream & out) {
-    if (g_cum_times->empty())
-        return;
-    out << "cumulative profiling times:\n";
-    for (auto const & p : *g_cum_times)
-        out << "\t" << p.first << " " << display_profiling_time{p.second} << "\n";
+    if (!g_cum_times->empty()) {
+        out << "cumulative profiling times:\n";
+        for (auto const & p : *g_cum_times)
+            out << "\t" << p.first << " " << display_profiling_time{p.second} << "\n";
+    }
+    if (!g_cum_counters->empty()) {
+        out << "cumulative profiling counters:\n";
+        for (auto const & p : *g_cum_counters)
+            out << "\t" << p.first << " " << p.second << "\n";
+    }
 }
 
 void initialize_time_task() {
     g_cum_times_mutex = new mutex;
     g_cum_times = new std::map<std::string, second_duration>;
+    g_cum_counters = new std::map<std::string, uint64>;
 }
 
 void finalize_time_task() {
+    delete g_cum_counters;
     delete g_cum_times;
     delete g_cum_times_mutex;
 }
@@ -13,6 +13,8 @@ Author: Sebastian Ullrich
 namespace lean {
 void report_profiling_time(std::string const & category, second_duration time);
 void display_cumulative_profiling_times(std::ostream & out);
+/** Add `n` to the counter `category`. Counters are displayed with the cumulative profiling times. */
+void report_profiling_counter(std::string const & category, uint64 n);
 
 /** Measure time of some task and report it for the final cumulative profile. */
 class time_task {
@@ -26,6 +26,7 @@ Author: Leonardo de Moura
 #define LEAN_SEGMENT_SIZE          8*1024*1024 // 8 Mb
 #define LEAN_NUM_SLOTS             (LEAN_MAX_SMALL_OBJECT_SIZE / LEAN_OBJECT_SIZE_DELTA)
 #define LEAN_MAX_TO_EXPORT_OBJS    1024
+#define LEAN_BIG_SAMPLE_RATIO      64          // big allocations are sampled 64 times more often than small ones
 
 LEAN_CASSERT(LEAN_PAGE_SIZE > LEAN_MAX_SMALL_OBJECT_SIZE);
 LEAN_CASSERT(LEAN_SEGMENT_SIZE > LEAN_PAGE_SIZE);
@@ -68,6 +69,8 @@ struct page_header {
     unsigned         m_num_free;
     unsigned         m_slot_idx;
     bool             m_in_page_free_list;
+    /* Number of objects in this page tracked by the allocation sampler. Other threads may update it. */
+    atomic<unsigned> m_num_sampled;
 };
 
 struct page {
@@ -112,6 +115,7 @@ struct segment {
 struct heap {
     segment * m_curr_segment{nullptr};
     heap *    m_next_orphan{nullptr};
+    heap *    m_next_heap{nullptr}; /* next heap in `heap_manager::m_heaps` */
     page *    m_curr_page[LEAN_NUM_SLOTS];
     page *    m_page_free_list[LEAN_NUM_SLOTS];
     /* Objects that must be sent to other heaps. */
@@ -122,15 +126,32 @@ struct heap {
        by other heaps. */
     void *    m_to_import_list{nullptr};
     uint64_t  m_heartbeat{0}; /* Counter for implementing "deterministic timeouts". It is currently the number of small allocations */
+    /* Value of `m_heartbeat` at which the next small allocation is sampled. Other threads may reset it. */
+    atomic<uint64_t> m_next_sample{UINT64_MAX};
+    uint64_t  m_big_until_sample{0}; /* Number of big allocations until the next one is sampled */
+    uint64_t  m_sample_seed{88172645463325252ull};
     void import_objs();
     void export_objs();
     void alloc_segment();
 };
 
 struct heap_manager {
-    /* The mutex protects the list of orphan segments. */
+    /* The mutex protects the list of orphan segments and the list of all heaps. */
     mutex             m_mutex;
     heap *            m_orphans{nullptr};
+    heap *            m_heaps{nullptr};
+
+    void push_heap(heap * h) {
+        lock_guard<mutex> lock(m_mutex);
+        h->m_next_heap = m_heaps;
+        m_heaps = h;
+    }
+
+    template<typename F> void for_each_heap(F && f) {
+        lock_guard<mutex> lock(m_mutex);
+        for (heap * h = m_heaps; h != nullptr; h = h->m_next_heap)
+            f(h);
+    }
 
     void push_orphan(heap * h) {
         /* TODO(Leo): avoid mutex */
@@ -315,9 +336,29 @@ static page * alloc_page(heap * h, unsigned obj_size) {
     p->m_header.m_max_free   = num_free;
     p->m_header.m_num_free   = num_free;
     p->m_header.m_in_page_free_list = false;
+    p->m_header.m_num_sampled = 0;
     return p;
 }
 
+/* Sampling interval for small allocations, 0 if the sampler is not running. */
+static atomic<uint64_t> g_sample_interval(0);
+/* Number of big objects tracked by the allocation sampler. */
+static atomic<unsigned> g_num_sampled_big(0);
+
+static void schedule_sample(heap * h) {
+    uint64_t interval = atomic_load_explicit(&g_sample_interval, memory_order_relaxed);
+    if (interval == 0) {
+        h->m_next_sample = UINT64_MAX;
+    } else {
+        /* Randomize the distance between samples (xorshift) to avoid aliasing with periodic allocation
+           patterns. The mean distance is `interval`. */
+        uint64_t x = h->m_sample_seed;
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        h->m_sample_seed = x;
+        h->m_next_sample = h->m_heartbeat + interval / 2 + x % interval + 1;
+    }
+}
+
 static void finalize_heap(void * _h) {
     heap * h = static_cast<heap*>(_h);
     h->export_objs();
@@ -333,6 +374,7 @@ static void init_heap(bool main) {
         g_heap = h;
     } else {
         g_heap = new heap();
+        g_heap_manager->push_heap(g_heap);
         g_curr_pages = g_heap->m_curr_page;
         for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
             g_heap->m_curr_page[i] = nullptr;
@@ -347,6 +389,7 @@ static void init_heap(bool main) {
             obj_size += LEAN_OBJECT_SIZE_DELTA;
         }
     }
+    schedule_sample(g_heap);
     if (!main)
         register_thread_finalizer(finalize_heap, g_heap);
 }
@@ -357,6 +400,55 @@ void init_thread_heap() {
     init_heap(false);
 }
 
+void set_alloc_sample_interval(uint64_t interval) {
+    g_sample_interval = interval;
+    /* Make the next small allocation of every heap take the slow path in `lean_alloc_small`, which
+       reschedules sampling using the new interval. */
+    uint64_t next = interval == 0 ? UINT64_MAX : 0;
+    g_heap_manager->for_each_heap([&](heap * h) { h->m_next_sample = next; });
+}
+
+void release_alloc_sample(void * o, size_t sz) {
+    if (sz > LEAN_MAX_SMALL_OBJECT_SIZE)
+        g_num_sampled_big--;
+    else
+        get_page_of(o)->m_header.m_num_sampled--;
+}
+
+#ifdef LEAN_ALLOC_SAMPLER
+LEAN_NOINLINE
+static void * lean_alloc_small_sampled(unsigned sz, unsigned slot_idx) {
+    uint64_t interval = atomic_load_explicit(&g_sample_interval, memory_order_relaxed);
+    /* Move `m_next_sample` past the current heartbeat before allocating. */
+    schedule_sample(g_heap);
+    void * r = lean_alloc_small(sz, slot_idx);
+    if (interval != 0 && alloc_sampler_record(r, sz, interval))
+        get_page_of(r)->m_header.m_num_sampled++;
+    return r;
+}
+
+LEAN_NOINLINE
+static void sample_big_alloc(void * r, size_t sz) {
+    uint64_t interval = atomic_load_explicit(&g_sample_interval, memory_order_relaxed) / LEAN_BIG_SAMPLE_RATIO;
+    if (interval == 0) interval = 1;
+    if (g_heap->m_big_until_sample > interval)
+        g_heap->m_big_until_sample = interval;
+    if (g_heap->m_big_until_sample <= 1) {
+        g_heap->m_big_until_sample = interval;
+        if (alloc_sampler_record(r, sz, interval))
+            g_num_sampled_big++;
+    } else {
+        g_heap->m_big_until_sample--;
+    }
+}
+
+LEAN_NOINLINE
+static void forget_sample(void * o, page * p) {
+    if (alloc_sampler_forget(o))
+        p->m_header.m_num_sampled--;
+}
+#endif
+
 LEAN_NOINLINE
 void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
     if (g_heap->m_page_free_list[slot_idx] == nullptr) {
@@ -379,6 +471,10 @@ void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
 }
 
 extern "C" LEAN_EXPORT void * lean_alloc_small(unsigned sz, unsigned slot_idx) {
+#ifdef LEAN_ALLOC_SAMPLER
+    if (LEAN_UNLIKELY(g_heap->m_heartbeat >= atomic_load_explicit(&g_heap->m_next_sample, memory_order_relaxed)))
+        return lean_alloc_small_sampled(sz, slot_idx);
+#endif
     page * p = g_heap->m_curr_page[slot_idx];
     g_heap->m_heartbeat++;
     void * r = p->m_header.m_free_list;
@@ -391,6 +487,15 @@ extern "C" LEAN_EXPORT void * lean_alloc_small(unsigned sz, unsigned slot_idx) {
     return r;
 }
 
+/* Return true if small objects are allocated by size class (see `compiler.reuseSizeClass`) */
+extern "C" LEAN_EXPORT uint8_t lean_small_allocator_enabled(lean_object *) {
+#ifdef LEAN_SMALL_ALLOCATOR
+    return true;
+#else
+    return false;
+#endif
+}
+
 /* Helper function for increasing hearbeat even when LEAN_SMALL_ALLOCATOR is not defined */
 extern "C" LEAN_EXPORT void lean_inc_heartbeat() {
     if (g_heap)
@@ -410,6 +515,10 @@ void * alloc(size_t sz) {
     if (LEAN_UNLIKELY(sz > LEAN_MAX_SMALL_OBJECT_SIZE)) {
         void * r = malloc(sz);
         if (r == nullptr) lean_internal_panic_out_of_memory();
+#ifdef LEAN_ALLOC_SAMPLER
+        if (LEAN_UNLIKELY(g_heap && atomic_load_explicit(&g_heap->m_next_sample, memory_order_relaxed) != UINT64_MAX))
+            sample_big_alloc(r, sz);
+#endif
         return r;
     }
     lean_assert(g_heap);
@@ -436,6 +545,10 @@ static inline void dealloc_small_core(void * o) {
     }
     lean_assert(g_heap);
     page * p = get_page_of(o);
+#ifdef LEAN_ALLOC_SAMPLER
+    if (LEAN_UNLIKELY(atomic_load_explicit(&p->m_header.m_num_sampled, memory_order_relaxed) != 0))
+        forget_sample(o, p);
+#endif
     if (LEAN_LIKELY(p->get_heap() == g_heap)) {
         p->push_free_obj(o);
     } else {
@@ -447,6 +560,10 @@ void dealloc(void * o, size_t sz) {
     LEAN_RUNTIME_STAT_CODE(g_num_dealloc++);
     sz = lean_align(sz, LEAN_OBJECT_SIZE_DELTA);
     if (LEAN_UNLIKELY(sz > LEAN_MAX_SMALL_OBJECT_SIZE)) {
+#ifdef LEAN_ALLOC_SAMPLER
+        if (LEAN_UNLIKELY(atomic_load_explicit(&g_num_sampled_big, memory_order_relaxed) != 0) && alloc_sampler_forget(o))
+            g_num_sampled_big--;
+#endif
         return free(o);
     }
     dealloc_small_core(o);
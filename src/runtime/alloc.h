@@ -13,6 +13,16 @@ void init_thread_heap();
 void * alloc(size_t sz);
 void dealloc(void * o, size_t sz);
 uint64_t get_num_heartbeats();
+/* Make every thread report roughly one in `interval` small allocations (and one in `interval / 64` big
+   allocations) to `alloc_sampler_record`. `interval == 0` disables sampling. */
+void set_alloc_sample_interval(uint64_t interval);
+/* Tell the allocator that the sampler stopped tracking the object `o` of size `sz`. */
+void release_alloc_sample(void * o, size_t sz);
+/* The following two functions are implemented by the sampling profiler in `allocprof.cpp`.
+   `alloc_sampler_record` returns true if the sampler is tracking `o` now, and `alloc_sampler_forget`
+   returns true if it was tracking `o`. */
+bool alloc_sampler_record(void * o, size_t sz, uint64_t weight);
+bool alloc_sampler_forget(void * o);
 void initialize_alloc();
 void finalize_alloc();
 }
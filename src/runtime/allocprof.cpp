@@ -4,10 +4,22 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <map>
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#include <dlfcn.h>
+#define LEAN_ALLOC_SAMPLER_BACKTRACE
+#endif
 #include "runtime/allocprof.h"
+#include "runtime/alloc.h"
+#include "runtime/thread.h"
 namespace lean {
 allocprof::allocprof(std::ostream & out, char const * msg):
     m_out(out), m_msg(msg) {
+        get_free_pause_histogram(m_free_pauses);
 #ifdef LEAN_RUNTIME_STATS
         m_num_ctor    = g_num_ctor;
         m_num_closure = g_num_closure;
@@ -20,6 +32,21 @@ allocprof::allocprof(std::ostream & out, char const * msg):
 }
 allocprof::~allocprof() {
     m_out << m_msg << "\n";
+    uint64 free_pauses[LEAN_NUM_FREE_PAUSE_BUCKETS];
+    get_free_pause_histogram(free_pauses);
+    bool first = true;
+    for (unsigned i = 0; i < LEAN_NUM_FREE_PAUSE_BUCKETS; i++) {
+        uint64 num = free_pauses[i] - m_free_pauses[i];
+        if (num == 0) continue;
+        if (first) {
+            m_out << "free pauses:\n";
+            first = false;
+        }
+        if (i + 1 < LEAN_NUM_FREE_PAUSE_BUCKETS)
+            m_out << "  < " << (static_cast<uint64>(1) << i) << "us: " << num << "\n";
+        else
+            m_out << "  >= " << (static_cast<uint64>(1) << (i - 1)) << "us: " << num << "\n";
+    }
 #ifdef LEAN_RUNTIME_STATS
     uint64 num_ctor    = g_num_ctor - m_num_ctor;
     uint64 num_closure = g_num_closure - m_num_closure;
@@ -44,4 +71,310 @@ allocprof::~allocprof() {
     m_out << "Allocation profiling data is not available, compile lean using `-D RUNTIME_STATS=ON`\n";
 #endif
 }
+
+namespace alloc_sampler {
+#define LEAN_ALLOC_SAMPLER_MAX_NATIVE_FRAMES 64
+
+typedef std::chrono::steady_clock sample_clock;
+
+struct location {
+    uintptr_t   m_addr; /* return address, 0 for interpreted functions */
+    std::string m_name;
+};
+
+struct live_sample {
+    unsigned                 m_stack;
+    unsigned                 m_size_class;
+    size_t                   m_size;
+    uint64                   m_weight;
+    sample_clock::time_point m_time;
+};
+
+struct totals {
+    uint64 m_objects{0};
+    uint64 m_bytes{0};
+    uint64 m_inuse_bytes{0};
+    uint64 m_lifetime{0}; /* nanoseconds */
+};
+
+struct state {
+    mutex                                           m_mutex; /* protects all fields */
+    bool                                            m_running{false};
+    uint64                                          m_interval{0};
+    sample_clock::time_point                        m_start;
+    std::chrono::system_clock::time_point           m_start_wall;
+    std::vector<location>                           m_locations;
+    std::unordered_map<uintptr_t, unsigned>         m_native_locations;
+    std::unordered_map<std::string, unsigned>       m_interp_locations;
+    std::map<std::vector<unsigned>, unsigned>       m_stack_ids;
+    std::vector<std::vector<unsigned>>              m_stacks;
+    std::map<std::pair<unsigned, unsigned>, totals> m_totals; /* (stack, size class) -> totals */
+    std::unordered_map<void *, live_sample>         m_live;
+
+    unsigned get_location(uintptr_t addr) {
+        auto it = m_native_locations.find(addr);
+        if (it != m_native_locations.end()) return it->second;
+        unsigned idx = m_locations.size();
+        m_locations.push_back(location{addr, std::string()});
+        m_native_locations.insert({addr, idx});
+        return idx;
+    }
+
+    unsigned get_location(std::string const & fn) {
+        auto it = m_interp_locations.find(fn);
+        if (it != m_interp_locations.end()) return it->second;
+        unsigned idx = m_locations.size();
+        m_locations.push_back(location{0, fn});
+        m_interp_locations.insert({fn, idx});
+        return idx;
+    }
+
+    unsigned get_stack(std::vector<unsigned> const & stack) {
+        auto it = m_stack_ids.find(stack);
+        if (it != m_stack_ids.end()) return it->second;
+        unsigned idx = m_stacks.size();
+        m_stacks.push_back(stack);
+        m_stack_ids.insert({stack, idx});
+        return idx;
+    }
+
+    void retire(live_sample const & s, sample_clock::time_point now, bool freed) {
+        totals & t = m_totals[std::make_pair(s.m_stack, s.m_size_class)];
+        uint64 lifetime = std::chrono::duration_cast<std::chrono::nanoseconds>(now - s.m_time).count();
+        t.m_lifetime += lifetime * s.m_weight;
+        if (!freed)
+            t.m_inuse_bytes += s.m_size * s.m_weight;
+    }
+
+    void clear() {
+        m_locations.clear();
+        m_native_locations.clear();
+        m_interp_locations.clear();
+        m_stack_ids.clear();
+        m_stacks.clear();
+        m_totals.clear();
+        m_live.clear();
+    }
+};
+
+static atomic<alloc_sampler_frames_fn> g_frames_fn(nullptr);
+
+static state & get_state() {
+    /* Never deleted: other threads may still free sampled objects during shutdown. */
+    static state * s = new state();
+    return *s;
+}
+
+/* Size class of an object of size `sz`: the small object size for small objects, and the next power of
+   two for big ones. */
+static unsigned get_size_class(size_t sz) {
+    if (sz <= LEAN_MAX_SMALL_OBJECT_SIZE)
+        return static_cast<unsigned>(sz);
+    unsigned r = LEAN_MAX_SMALL_OBJECT_SIZE;
+    while (r < sz && r < (1u << 31)) r *= 2;
+    return r;
+}
+
+/* Minimal protobuf encoder for the pprof `Profile` message. */
+class pb_writer {
+    std::string m_buf;
+public:
+    void varint(uint64 v) {
+        while (v >= 0x80) {
+            m_buf.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        m_buf.push_back(static_cast<char>(v));
+    }
+    void int_field(unsigned field, uint64 v) { varint(field << 3); varint(v); }
+    void bytes_field(unsigned field, std::string const & v) { varint((field << 3) | 2); varint(v.size()); m_buf += v; }
+    void msg_field(unsigned field, pb_writer const & m) { bytes_field(field, m.m_buf); }
+    void packed_field(unsigned field, std::vector<uint64> const & vs) {
+        pb_writer m;
+        for (uint64 v : vs) m.varint(v);
+        msg_field(field, m);
+    }
+    std::string const & str() const { return m_buf; }
+};
+
+class string_table {
+    std::vector<std::string>                  m_strings;
+    std::unordered_map<std::string, unsigned> m_ids;
+public:
+    string_table() { get(""); }
+    unsigned get(std::string const & s) {
+        auto it = m_ids.find(s);
+        if (it != m_ids.end()) return it->second;
+        unsigned idx = m_strings.size();
+        m_strings.push_back(s);
+        m_ids.insert({s, idx});
+        return idx;
+    }
+    std::vector<std::string> const & strings() const { return m_strings; }
+};
+
+static std::string get_native_name(uintptr_t addr) {
+#ifdef LEAN_ALLOC_SAMPLER_BACKTRACE
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void *>(addr), &info)) {
+        if (info.dli_sname)
+            return info.dli_sname;
+        if (info.dli_fname) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "+0x%lx", static_cast<unsigned long>(addr - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+            return std::string(info.dli_fname) + buf;
+        }
+    }
+#endif
+    char buf[32];
+    snprintf(buf, sizeof(buf), "0x%lx", static_cast<unsigned long>(addr));
+    return buf;
+}
+
+static void write_pprof(state & s, std::ostream & out) {
+    string_table strs;
+    pb_writer prof;
+    auto value_type = [&](unsigned field, char const * type, char const * unit) {
+        pb_writer vt;
+        vt.int_field(1, strs.get(type));
+        vt.int_field(2, strs.get(unit));
+        prof.msg_field(field, vt);
+    };
+    value_type(1, "alloc_objects", "count");
+    value_type(1, "alloc_space", "bytes");
+    value_type(1, "inuse_space", "bytes");
+    value_type(1, "lifetime", "nanoseconds");
+    for (auto const & e : s.m_totals) {
+        pb_writer sample;
+        std::vector<uint64> locs;
+        for (unsigned l : s.m_stacks[e.first.first])
+            locs.push_back(l + 1);
+        sample.packed_field(1, locs);
+        totals const & t = e.second;
+        sample.packed_field(2, {t.m_objects, t.m_bytes, t.m_inuse_bytes, t.m_lifetime});
+        pb_writer label;
+        label.int_field(1, strs.get("size_class"));
+        label.int_field(3, e.first.second);
+        label.int_field(4, strs.get("bytes"));
+        sample.msg_field(3, label);
+        prof.msg_field(2, sample);
+    }
+    for (unsigned i = 0; i < s.m_locations.size(); i++) {
+        location const & l = s.m_locations[i];
+        std::string name = l.m_addr ? get_native_name(l.m_addr) : l.m_name;
+        pb_writer fn;
+        fn.int_field(1, i + 1);
+        fn.int_field(2, strs.get(name));
+        fn.int_field(3, strs.get(name));
+        prof.msg_field(5, fn);
+        pb_writer line;
+        line.int_field(1, i + 1);
+        pb_writer loc;
+        loc.int_field(1, i + 1);
+        if (l.m_addr)
+            loc.int_field(3, l.m_addr);
+        loc.msg_field(4, line);
+        prof.msg_field(4, loc);
+    }
+    prof.int_field(9, std::chrono::duration_cast<std::chrono::nanoseconds>(s.m_start_wall.time_since_epoch()).count());
+    prof.int_field(10, std::chrono::duration_cast<std::chrono::nanoseconds>(sample_clock::now() - s.m_start).count());
+    pb_writer period_type;
+    period_type.int_field(1, strs.get("alloc_objects"));
+    period_type.int_field(2, strs.get("count"));
+    prof.msg_field(11, period_type);
+    prof.int_field(12, s.m_interval);
+    /* The string table must be the last field since the fields above add to it. */
+    for (std::string const & str : strs.strings())
+        prof.bytes_field(6, str);
+    out.write(prof.str().data(), prof.str().size());
+}
+}
+using namespace alloc_sampler; // NOLINT
+
+void set_alloc_sampler_frames_fn(alloc_sampler_frames_fn fn) {
+    g_frames_fn = fn;
+}
+
+bool alloc_sampler_record(void * o, size_t sz, uint64_t weight) {
+    /* Collect the stack before taking the lock: the frames function may allocate and free objects. */
+    std::vector<std::string> frames;
+    if (alloc_sampler_frames_fn fn = g_frames_fn)
+        fn(frames);
+#ifdef LEAN_ALLOC_SAMPLER_BACKTRACE
+    void * addrs[LEAN_ALLOC_SAMPLER_MAX_NATIVE_FRAMES];
+    int num_addrs = backtrace(addrs, LEAN_ALLOC_SAMPLER_MAX_NATIVE_FRAMES);
+#endif
+    state & s = get_state();
+    lock_guard<mutex> lock(s.m_mutex);
+    if (!s.m_running)
+        return false;
+    std::vector<unsigned> stack;
+    for (std::string const & fn : frames)
+        stack.push_back(s.get_location(fn));
+#ifdef LEAN_ALLOC_SAMPLER_BACKTRACE
+    /* Skip `alloc_sampler_record` itself. */
+    for (int i = 1; i < num_addrs; i++)
+        stack.push_back(s.get_location(reinterpret_cast<uintptr_t>(addrs[i])));
+#endif
+    unsigned stack_id   = s.get_stack(stack);
+    unsigned size_class = get_size_class(sz);
+    totals & t = s.m_totals[std::make_pair(stack_id, size_class)];
+    t.m_objects += weight;
+    t.m_bytes   += sz * weight;
+    s.m_live[o] = live_sample{stack_id, size_class, sz, weight, sample_clock::now()};
+    return true;
+}
+
+bool alloc_sampler_forget(void * o) {
+    state & s = get_state();
+    lock_guard<mutex> lock(s.m_mutex);
+    auto it = s.m_live.find(o);
+    if (it == s.m_live.end())
+        return false;
+    s.retire(it->second, sample_clock::now(), true);
+    s.m_live.erase(it);
+    return true;
+}
+
+void start_alloc_sampler(uint64 interval) {
+    lean_assert(interval > 0);
+#ifdef LEAN_ALLOC_SAMPLER_BACKTRACE
+    /* The first call to `backtrace` may load libgcc, make sure this does not happen while sampling. */
+    void * addrs[1];
+    backtrace(addrs, 1);
+#endif
+    state & s = get_state();
+    {
+        lock_guard<mutex> lock(s.m_mutex);
+        s.clear();
+        s.m_running    = true;
+        s.m_interval   = interval;
+        s.m_start      = sample_clock::now();
+        s.m_start_wall = std::chrono::system_clock::now();
+    }
+    set_alloc_sample_interval(interval);
+}
+
+void stop_alloc_sampler(std::ostream & out) {
+    set_alloc_sample_interval(0);
+    state & s = get_state();
+    lock_guard<mutex> lock(s.m_mutex);
+    if (!s.m_running)
+        return;
+    s.m_running = false;
+    /* Objects that are still alive contribute their age so far to `lifetime`. */
+    sample_clock::time_point now = sample_clock::now();
+    for (auto const & e : s.m_live) {
+        s.retire(e.second, now, false);
+        release_alloc_sample(e.first, e.second.m_size);
+    }
+    write_pprof(s, out);
+    s.clear();
+}
+
+bool is_alloc_sampler_running() {
+    state & s = get_state();
+    lock_guard<mutex> lock(s.m_mutex);
+    return s.m_running;
+}
 }
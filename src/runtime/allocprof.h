@@ -6,13 +6,17 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <string>
+#include <vector>
 #include "runtime/object.h"
 namespace lean {
 /* Low tech runtime allocation profiler.
-   We need to compile Lean using RUNTIME_STATS=ON to use it. */
+   We need to compile Lean using RUNTIME_STATS=ON to use it.
+   The histogram of pause times spent freeing object graphs is always available. */
 class allocprof {
-    std::ostream & m_out;
-    std::string    m_msg;
+    std::ostream &          m_out;
+    std::string             m_msg;
+    scoped_free_pause_stats m_free_pause_stats;
+    uint64                  m_free_pauses[LEAN_NUM_FREE_PAUSE_BUCKETS];
 #ifdef LEAN_RUNTIME_STATS
     uint64 m_num_ctor;
     uint64 m_num_closure;
@@ -26,4 +30,16 @@ public:
     allocprof(std::ostream & out, char const * msg);
     ~allocprof();
 };
+
+/* Sampling allocation profiler. While it is running, every thread records roughly one in `interval`
+   small allocations together with the call stack of the allocation, the size class of the object, and
+   the time the object stays alive. The call stack consists of the frames reported by the function set
+   using `set_alloc_sampler_frames_fn` (the IR interpreter registers itself here), followed by the native
+   return addresses. `stop_alloc_sampler` writes the result in the (uncompressed) pprof format. */
+void start_alloc_sampler(uint64 interval);
+void stop_alloc_sampler(std::ostream & out);
+bool is_alloc_sampler_running();
+/* Store the names of the functions being executed on the current thread, innermost first, in `frames`. */
+typedef void (*alloc_sampler_frames_fn)(std::vector<std::string> & frames);
+void set_alloc_sampler_frames_fn(alloc_sampler_frames_fn fn);
 }
@@ -19,6 +19,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #endif
 // Linux include files
 #include <unistd.h> // NOLINT
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/random.h>
 #endif
@@ -33,6 +34,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <vector>
 #include <cstdlib>
 #include <cctype>
 #include <sys/stat.h>
@@ -46,6 +48,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 
 #ifdef _MSC_VER
 #define S_ISDIR(mode) ((mode & _S_IFDIR) != 0)
+#define S_ISREG(mode) ((mode & _S_IFREG) != 0)
 #else
 #include <dirent.h>
 #endif
@@ -263,6 +266,23 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_mk(b_obj_arg filename, b_obj_
     }
 }
 
+/*
+  Handle.mkBuffered (filename : @& String) (mode : @& String) (bufferSize : USize) : IO Handle
+  Like `Handle.mk`, but uses a stream buffer of `bufferSize` bytes. A buffer size of `0` makes the handle unbuffered. */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_mk_buffered(b_obj_arg filename, b_obj_arg modeStr, usize buffer_size, obj_arg /* w */) {
+    FILE *fp = fopen(lean_string_cstr(filename), lean_string_cstr(modeStr));
+    if (!fp) {
+        return io_result_mk_error(decode_io_error(errno, filename));
+    }
+    // `setvbuf` must be called before any other operation on the stream
+    if (std::setvbuf(fp, nullptr, buffer_size == 0 ? _IONBF : _IOFBF, buffer_size) != 0) {
+        int errnum = errno;
+        fclose(fp);
+        return io_result_mk_error(decode_io_error(errnum, filename));
+    }
+    return io_result_mk_ok(io_wrap_handle(fp));
+}
+
 /* Handle.isEof : (@& Handle) → BaseIO Bool */
 extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_is_eof(b_obj_arg h, obj_arg /* w */) {
     FILE * fp = io_get_handle(h);
@@ -311,39 +331,159 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg
     }
 }
 
+/* Return the number of bytes left between the current position of `fp` and the end of the file,
+   or `0` if `fp` is not a regular file. */
+static usize io_remaining_file_size(FILE * fp) {
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode))
+        return 0;
+    long pos = std::ftell(fp);
+    if (pos < 0 || st.st_size <= pos)
+        return 0;
+    return static_cast<usize>(st.st_size - pos);
+}
+
+/*
+  Read the rest of `fp` into a single byte array. For regular files, the array is allocated once
+  with the remaining file size, so that no intermediate copies are made. */
+static obj_res io_read_bin_to_end(FILE * fp) {
+    // one extra byte so that the end of file is detected without growing the array
+    usize cap = io_remaining_file_size(fp) + 1;
+    if (cap < 1024) cap = 1024;
+    obj_res res = lean_alloc_sarray(1, 0, cap);
+    usize sz    = 0;
+    while (true) {
+        if (sz == cap) {
+            obj_res new_res = lean_alloc_sarray(1, 0, 2*cap);
+            memcpy(lean_sarray_cptr(new_res), lean_sarray_cptr(res), sz);
+            lean_free_object(res);
+            res  = new_res;
+            cap *= 2;
+        }
+        usize n = std::fread(lean_sarray_cptr(res) + sz, 1, cap - sz, fp);
+        bool done = n < cap - sz;
+        sz += n;
+        if (done) {
+            if (std::ferror(fp)) {
+                lean_free_object(res);
+                return io_result_mk_error(decode_io_error(errno, nullptr));
+            }
+            lean_sarray_set_size(res, sz);
+            return io_result_mk_ok(res);
+        }
+    }
+}
+
+/* Handle.readBinToEnd : (@& Handle) → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_bin_to_end(b_obj_arg h, obj_arg /* w */) {
+    return io_read_bin_to_end(io_get_handle(h));
+}
+
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+struct io_mapping {
+    void * m_base;
+    usize  m_size;
+};
+
+static void io_munmap(void * data) {
+    io_mapping * m = static_cast<io_mapping *>(data);
+    munmap(m->m_base, m->m_size);
+    delete m;
+}
+#endif
+
+/*
+  Handle.mmap : (@& Handle) → IO ByteArray
+  Map the whole file underlying the handle into memory and return it as a byte array.
+  The mapping is private and copy-on-write, so destructive updates of the array do not modify the file.
+  It is unmapped when the array is freed, see `register_foreign_sarray`.
+  On platforms without `mmap`, the file is read into memory instead. */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_mmap(b_obj_arg h, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+#if defined(LEAN_WINDOWS) || defined(LEAN_EMSCRIPTEN)
+    long pos = std::ftell(fp);
+    if (pos < 0 || std::fseek(fp, 0, SEEK_SET) != 0) {
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    obj_res r = io_read_bin_to_end(fp);
+    std::fseek(fp, pos, SEEK_SET);
+    return r;
+#else
+    int fd = fileno(fp);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    if (!S_ISREG(st.st_mode)) {
+        return io_result_mk_error(decode_io_error(EINVAL, nullptr));
+    }
+    usize sz = st.st_size;
+    if (sz == 0) {
+        return io_result_mk_ok(alloc_sarray(1, 0, 0));
+    }
+    /* The file contents must start at a page boundary, but the array data is preceded by the
+       object header. So we reserve one extra page in front of the file mapping for the header. */
+    usize page_sz = sysconf(_SC_PAGESIZE);
+    usize map_sz  = (sz + page_sz - 1) / page_sz * page_sz;
+    char * base   = static_cast<char *>(mmap(nullptr, page_sz + map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED) {
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    if (mmap(base + page_sz, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int errnum = errno;
+        munmap(base, page_sz + map_sz);
+        return io_result_mk_error(decode_io_error(errnum, nullptr));
+    }
+    lean_sarray_object * o = reinterpret_cast<lean_sarray_object *>(base + page_sz - sizeof(lean_sarray_object));
+    lean_assert(reinterpret_cast<char *>(o->m_data) == base + page_sz);
+    lean_set_st_header(reinterpret_cast<lean_object *>(o), LeanScalarArray, 1);
+    o->m_size     = sz;
+    o->m_capacity = sz;
+    register_foreign_sarray(reinterpret_cast<lean_object *>(o), io_munmap, new io_mapping{base, page_sz + map_sz});
+    return io_result_mk_ok(reinterpret_cast<lean_object *>(o));
+#endif
+}
+
 static object * g_io_error_getline = nullptr;
 
 /*
   Handle.getLine : (@& Handle) → IO Unit
   The line returned by `lean_io_prim_handle_get_line`
   is truncated at the first '\0' character and the
-  rest of the line is discarded. */
+  rest of the line is discarded.
+  The line is read directly into the resulting string object,
+  whose capacity is doubled whenever the line does not fit. */
 extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg /* w */) {
-    FILE * fp = io_get_handle(h);
-    const int buf_sz = 64;
-    char buf_str[buf_sz]; // NOLINT
-    std::string result;
-    bool first = true;
+    FILE * fp  = io_get_handle(h);
+    size_t cap = 64;
+    size_t sz  = 0; // number of bytes read so far
+    object * r = lean_alloc_string(1, cap, 0);
     while (true) {
-        char * out = std::fgets(buf_str, buf_sz, fp);
+        char * buf = lean_to_string(r)->m_data;
+        char * out = std::fgets(buf + sz, static_cast<int>(cap - sz), fp);
         if (out != nullptr) {
-            if (strlen(buf_str) < buf_sz-1 || buf_str[buf_sz-2] == '\n') {
-                if (first) {
-                    return io_result_mk_ok(mk_string(out));
-                } else {
-                    result.append(out);
-                    return io_result_mk_ok(mk_string(result));
-                }
-            }
-            result.append(out);
+            size_t n = strlen(out);
+            sz += n;
+            if (sz < cap - 1 || buf[cap - 2] == '\n')
+                break;
+            object * new_r = lean_alloc_string(1, 2*cap, 0);
+            memcpy(lean_to_string(new_r)->m_data, buf, sz);
+            lean_free_object(r);
+            r    = new_r;
+            cap *= 2;
         } else if (std::feof(fp)) {
             clearerr(fp);
-            return io_result_mk_ok(mk_string(result));
+            break;
         } else {
+            lean_free_object(r);
             return io_result_mk_error(g_io_error_getline);
         }
-        first = false;
     }
+    lean_string_object * o = lean_to_string(r);
+    o->m_data[sz] = 0;
+    o->m_size     = sz + 1;
+    o->m_length   = utf8_strlen(o->m_data, sz);
+    return io_result_mk_ok(r);
 }
 
 /* Handle.putStr : (@& Handle) → (@& String) → IO Unit */
@@ -356,6 +496,212 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_put_str(b_obj_arg h, b_obj_ar
     }
 }
 
+#if defined(LEAN_MULTI_THREAD) && !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#define LEAN_IO_EVENT_LOOP
+#endif
+
+#if defined(LEAN_IO_EVENT_LOOP)
+/*
+  Event loop for waiting on file descriptors without occupying a task manager worker.
+  A single thread `poll`s the registered file descriptors, and finishes the pending task
+  associated with a file descriptor as soon as it becomes ready. The thread is started
+  on the first registration. */
+class io_event_loop {
+    struct waiter {
+        int                m_fd;
+        short              m_events;
+        lean_task_object * m_task;
+        /* The handle owning `m_fd`. We keep it alive so that `m_fd` is not closed, and reused by
+           another file, while we are waiting on it. */
+        object *           m_handle;
+    };
+    mutex               m_mutex;
+    std::vector<waiter> m_waiters;
+    int                 m_wakeup_pipe[2]{-1, -1};
+    lthread *           m_thread{nullptr};
+    bool                m_shutting_down{false};
+
+    void wakeup() {
+        char c = 0;
+        while (write(m_wakeup_pipe[1], &c, 1) < 0 && errno == EINTR) {}
+    }
+
+    void run() {
+        std::vector<pollfd> fds;
+        std::vector<waiter> ready;
+        while (true) {
+            fds.clear();
+            fds.push_back(pollfd{m_wakeup_pipe[0], POLLIN, 0});
+            {
+                unique_lock<mutex> lock(m_mutex);
+                if (m_shutting_down)
+                    return;
+                for (waiter const & w : m_waiters)
+                    fds.push_back(pollfd{w.m_fd, w.m_events, 0});
+            }
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                lean_always_assert(errno == EINTR);
+                continue;
+            }
+            if (fds[0].revents != 0) {
+                char buf[64];
+                while (read(m_wakeup_pipe[0], buf, sizeof(buf)) == sizeof(buf)) {}
+            }
+            {
+                unique_lock<mutex> lock(m_mutex);
+                /* Only this thread removes waiters, and new ones are appended at the end,
+                   so `fds[i+1]` still corresponds to `m_waiters[i]`. */
+                size_t j = 0;
+                for (size_t i = 0; i < m_waiters.size(); i++) {
+                    if (i + 1 < fds.size() && fds[i + 1].revents != 0)
+                        ready.push_back(m_waiters[i]);
+                    else
+                        m_waiters[j++] = m_waiters[i];
+                }
+                m_waiters.resize(j);
+            }
+            // errors and hang-ups are reported by the subsequent read or write operation
+            for (waiter const & w : ready) {
+                resolve_pending_task(w.m_task, box(0));
+                lean_dec(w.m_handle);
+            }
+            ready.clear();
+        }
+    }
+
+public:
+    ~io_event_loop() {
+        if (m_thread) {
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_shutting_down = true;
+            }
+            wakeup();
+            m_thread->join();
+            delete m_thread;
+            close(m_wakeup_pipe[0]);
+            close(m_wakeup_pipe[1]);
+        }
+    }
+
+    /* Return a task that finishes when the file descriptor `fd` of the handle `h` is ready for `events`,
+       or `nullptr` if we cannot wait asynchronously. */
+    lean_task_object * wait(b_obj_arg h, int fd, short events) {
+        lean_task_object * t = mk_pending_task();
+        if (!t)
+            return nullptr;
+        unique_lock<mutex> lock(m_mutex);
+        if (!m_thread) {
+            if (pipe(m_wakeup_pipe) != 0) {
+                lock.unlock();
+                resolve_pending_task(t, box(0));
+                return t;
+            }
+            fcntl(m_wakeup_pipe[0], F_SETFL, O_NONBLOCK);
+            fcntl(m_wakeup_pipe[1], F_SETFL, O_NONBLOCK);
+            m_thread = new lthread([this]() { run(); });
+        }
+        // `h` is released by the event loop thread
+        lean_mark_mt(h);
+        lean_inc(h);
+        m_waiters.push_back(waiter{fd, events, t, h});
+        lock.unlock();
+        wakeup();
+        return t;
+    }
+};
+
+static io_event_loop * g_io_event_loop = nullptr;
+
+/* Return the number of input bytes buffered in user space by `fp`, or `-1` if it cannot be determined on this
+   platform. If there is buffered input, the readiness of the underlying file descriptor does not tell us whether
+   reading from `fp` would block. */
+static ptrdiff_t io_buffered_input(FILE * fp) {
+#if defined(__GLIBC__)
+    return fp->_IO_read_end - fp->_IO_read_ptr;
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    return fp->_r > 0 ? fp->_r : 0;
+#else
+    (void)fp;
+    return -1;
+#endif
+}
+#endif
+
+static obj_res io_wait_handle(b_obj_arg h, bool read) {
+#if defined(LEAN_IO_EVENT_LOOP)
+    FILE * fp = io_get_handle(h);
+    if (!read || io_buffered_input(fp) == 0) {
+        if (lean_task_object * t = g_io_event_loop->wait(h, fileno(fp), read ? POLLIN : POLLOUT))
+            return io_result_mk_ok(reinterpret_cast<object *>(t));
+    }
+#else
+    (void)h; (void)read;
+#endif
+    return io_result_mk_ok(lean_task_pure(box(0)));
+}
+
+/*
+  Handle.waitReadable : (@& Handle) → BaseIO (Task Unit)
+  Return a task that finishes when reading from the handle would not block,
+  i.e., when data is available, the end of file was reached, or an error occurred.
+  Waiting is performed by the I/O event loop and does not block a task manager worker.
+  The handle is kept open until the task finishes. */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_wait_readable(b_obj_arg h, obj_arg /* w */) {
+    return io_wait_handle(h, true);
+}
+
+/*
+  Handle.waitWritable : (@& Handle) → BaseIO (Task Unit)
+  Return a task that finishes when writing to the handle would not block. */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_wait_writable(b_obj_arg h, obj_arg /* w */) {
+    return io_wait_handle(h, false);
+}
+
+/*
+  Handle.readAvailable : (@& Handle) → USize → Bool → IO (Option ByteArray)
+  Read at most `nbytes` bytes that are available without blocking, and stop after the first newline if
+  `until_newline` is true. Return `none` if no data is available yet, and an empty array at the end of the file.
+  Input buffered by the handle is consumed first, otherwise at most one `read` system call is made, and only
+  after `poll` has reported the file descriptor as readable. On platforms without the I/O event loop, or where
+  the input buffered by `FILE` cannot be inspected, this blocks like `Handle.read` and `Handle.getLine`. */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_available(b_obj_arg h, usize nbytes, uint8 until_newline, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+#if defined(LEAN_IO_EVENT_LOOP)
+    ptrdiff_t buffered = io_buffered_input(fp);
+    if (buffered == 0) {
+        pollfd pfd{fileno(fp), POLLIN, 0};
+        int r;
+        while ((r = poll(&pfd, 1, 0)) < 0 && errno == EINTR) {}
+        if (r == 0)
+            return io_result_mk_ok(mk_option_none());
+    }
+#endif
+    obj_res res = lean_alloc_sarray(1, 0, nbytes);
+    usize sz    = 0;
+    while (sz < nbytes) {
+#if defined(LEAN_IO_EVENT_LOOP)
+        // the first byte may need a system call, the remaining ones are taken from the buffer
+        if (sz > 0 && io_buffered_input(fp) <= 0)
+            break;
+#endif
+        int c = std::getc(fp);
+        if (c == EOF) {
+            if (std::ferror(fp)) {
+                lean_free_object(res);
+                return io_result_mk_error(decode_io_error(errno, nullptr));
+            }
+            clearerr(fp);
+            break;
+        }
+        lean_sarray_cptr(res)[sz++] = static_cast<uint8>(c);
+        if (until_newline && c == '\n')
+            break;
+    }
+    lean_sarray_set_size(res, sz);
+    return io_result_mk_ok(mk_option_some(res));
+}
+
 /* monoMsNow : BaseIO Nat */
 extern "C" LEAN_EXPORT obj_res lean_io_mono_ms_now(obj_arg /* w */) {
     static_assert(sizeof(std::chrono::milliseconds::rep) <= sizeof(uint64));
@@ -459,6 +805,56 @@ extern "C" LEAN_EXPORT obj_res lean_io_allocprof(b_obj_arg msg, obj_arg fn, obj_
     return res;
 }
 
+/* startAllocSampler (interval : USize) : IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_start_alloc_sampler(usize interval, obj_arg /* w */) {
+#ifndef LEAN_ALLOC_SAMPLER
+    (void)interval;
+    return io_result_mk_error("allocation sampler is not available, Lean must be compiled with ALLOC_SAMPLER=ON");
+#else
+    if (interval == 0)
+        return io_result_mk_error("allocation sampling interval must be positive");
+    if (is_alloc_sampler_running())
+        return io_result_mk_error("allocation sampler is already running");
+    start_alloc_sampler(interval);
+    return io_result_mk_ok(box(0));
+#endif
+}
+
+/* stopAllocSampler (fname : @& FilePath) : IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_stop_alloc_sampler(b_obj_arg fname, obj_arg /* w */) {
+    if (!is_alloc_sampler_running())
+        return io_result_mk_error("allocation sampler is not running");
+    std::ofstream out(string_cstr(fname), std::ios::binary);
+    if (!out) {
+        std::ostringstream discard;
+        stop_alloc_sampler(discard);
+        return io_result_mk_error(decode_io_error(errno, fname));
+    }
+    stop_alloc_sampler(out);
+    return io_result_mk_ok(box(0));
+}
+
+/* setDeferredFreeBudget (budgetUs : USize) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_set_deferred_free_budget(usize budget_us, obj_arg /* w */) {
+    lean_set_deferred_free_budget(budget_us);
+    return io_result_mk_ok(box(0));
+}
+
+/* freeDeferred : BaseIO Nat */
+extern "C" LEAN_EXPORT obj_res lean_io_free_deferred(obj_arg /* w */) {
+    return io_result_mk_ok(lean_usize_to_nat(lean_free_deferred()));
+}
+
+/* getFreePauseHistogram : BaseIO (Array Nat) */
+extern "C" LEAN_EXPORT obj_res lean_io_get_free_pause_histogram(obj_arg /* w */) {
+    uint64 buckets[LEAN_NUM_FREE_PAUSE_BUCKETS];
+    get_free_pause_histogram(buckets);
+    obj_res r = lean_alloc_array(0, LEAN_NUM_FREE_PAUSE_BUCKETS);
+    for (uint64 b : buckets)
+        r = lean_array_push(r, lean_uint64_to_nat(b));
+    return io_result_mk_ok(r);
+}
+
 /* getNumHeartbeats : BaseIO Nat */
 extern "C" LEAN_EXPORT obj_res lean_io_get_num_heartbeats(obj_arg /* w */) {
     return io_result_mk_ok(lean_uint64_to_nat(get_num_heartbeats()));
@@ -816,6 +1212,39 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_swap(b_obj_arg ref, obj_arg a, obj_ar
     }
 }
 
+/*
+  Ref.ptrCompareAndSwap {σ α} (r : @& Ref σ α) (expected : @& α) (new : α) : ST σ Bool
+  Store `new` in `r` if `r` contains (a pointer equal to) `expected`. */
+extern "C" LEAN_EXPORT obj_res lean_st_ref_ptr_compare_and_swap(b_obj_arg ref, b_obj_arg expected, obj_arg a, obj_arg) {
+    if (ref_maybe_mt(ref)) {
+        /* See io_ref_write */
+        mark_mt(a);
+        atomic<object *> * val_addr = mt_ref_val_addr(ref);
+        while (true) {
+            object * val = expected;
+            if (val_addr->compare_exchange_strong(val, a)) {
+                /* We now own the RC token for `expected` that was stored in the ref.
+                   The caller still owns another one, so `dec` cannot free `expected`. */
+                dec(expected);
+                return io_result_mk_ok(box(true));
+            }
+            if (val != nullptr) {
+                dec(a);
+                return io_result_mk_ok(box(false));
+            }
+            /* Another thread temporarily took the value (see `lean_st_ref_get`), retry. */
+        }
+    } else {
+        if (lean_to_ref(ref)->m_value != expected) {
+            dec(a);
+            return io_result_mk_ok(box(false));
+        }
+        dec(expected);
+        lean_to_ref(ref)->m_value = a;
+        return io_result_mk_ok(box(true));
+    }
+}
+
 extern "C" LEAN_EXPORT obj_res lean_st_ref_ptr_eq(b_obj_arg ref1, b_obj_arg ref2, obj_arg) {
     // TODO(Leo): ref_maybe_mt
     bool r = lean_to_ref(ref1)->m_value == lean_to_ref(ref2)->m_value;
@@ -907,8 +1336,14 @@ void initialize_io() {
     // We want to handle SIGPIPE ourselves
     lean_always_assert(signal(SIGPIPE, SIG_IGN) != SIG_ERR);
 #endif
+#if defined(LEAN_IO_EVENT_LOOP)
+    g_io_event_loop = new io_event_loop();
+#endif
 }
 
 void finalize_io() {
+#if defined(LEAN_IO_EVENT_LOOP)
+    delete g_io_event_loop;
+#endif
 }
 }
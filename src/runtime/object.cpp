@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <vector>
 #include <deque>
+#include <unordered_map>
 #include <cmath>
 #include <lean/lean.h>
 #include "runtime/object.h"
@@ -150,10 +151,51 @@ static inline void lean_dealloc(lean_object * o, size_t sz) {
 #endif
 }
 
+/* Scalar arrays registered using `register_foreign_sarray`. We only consult the table when freeing a scalar array
+   whose data is aligned to 4096 bytes, and at least one such array exists. */
+struct foreign_sarray {
+    void (*m_finalize)(void *);
+    void * m_data;
+};
+static mutex * g_foreign_sarrays_mutex = nullptr;
+static std::unordered_map<object *, foreign_sarray> * g_foreign_sarrays = nullptr;
+static atomic<size_t> g_num_foreign_sarrays(0);
+
+void register_foreign_sarray(object * o, void (*finalize)(void *), void * data) {
+    lean_assert((reinterpret_cast<uintptr_t>(lean_sarray_cptr(o)) & 4095) == 0);
+    unique_lock<mutex> lock(*g_foreign_sarrays_mutex);
+    g_foreign_sarrays->insert(std::make_pair(o, foreign_sarray{finalize, data}));
+    g_num_foreign_sarrays++;
+}
+
+/* Return `false` if `o` is not a foreign scalar array. */
+static bool free_foreign_sarray(object * o) {
+    foreign_sarray f;
+    {
+        unique_lock<mutex> lock(*g_foreign_sarrays_mutex);
+        auto it = g_foreign_sarrays->find(o);
+        if (it == g_foreign_sarrays->end())
+            return false;
+        f = it->second;
+        g_foreign_sarrays->erase(it);
+        g_num_foreign_sarrays--;
+    }
+    f.m_finalize(f.m_data);
+    return true;
+}
+
+static inline void lean_free_sarray(lean_object * o) {
+    if (LEAN_UNLIKELY(atomic_load_explicit(&g_num_foreign_sarrays, memory_order_relaxed) > 0) &&
+        (reinterpret_cast<uintptr_t>(lean_sarray_cptr(o)) & 4095) == 0 &&
+        free_foreign_sarray(o))
+        return;
+    lean_dealloc(o, lean_sarray_byte_size(o));
+}
+
 extern "C" LEAN_EXPORT void lean_free_object(lean_object * o) {
     switch (lean_ptr_tag(o)) {
     case LeanArray:       return lean_dealloc(o, lean_array_byte_size(o));
-    case LeanScalarArray: return lean_dealloc(o, lean_sarray_byte_size(o));
+    case LeanScalarArray: return lean_free_sarray(o);
     case LeanString:      return lean_dealloc(o, lean_string_byte_size(o));
     case LeanMPZ:         to_mpz(o)->m_value.~mpz(); return lean_free_small_object(o);
     default:              return lean_free_small_object(o);
@@ -258,7 +300,7 @@ static void lean_del_core(object * o, object * & todo) {
             break;
         }
         case LeanScalarArray:
-            lean_dealloc(o, lean_sarray_byte_size(o));
+            lean_free_sarray(o);
             break;
         case LeanString:
             lean_dealloc(o, lean_string_byte_size(o));
@@ -289,11 +331,221 @@ static void lean_del_core(object * o, object * & todo) {
     }
 }
 
+/* Maximum time in nanoseconds spent by a single `lean_dec_ref_cold` call in deferred-free mode,
+   `0` if deferred-free mode is disabled. It is read by all threads when freeing objects.
+   Remark: in deferred-free mode, the finalizers of external objects in postponed graphs (e.g., closing file handles)
+   may run late, or on the thread freeing postponed graphs. */
+static atomic<uint64> g_deferred_free_budget_ns(0);
+/* Number of active `scoped_free_pause_stats` objects. */
+static atomic<unsigned> g_free_pause_stats_users(0);
+static atomic<uint64> g_free_pause_histogram[LEAN_NUM_FREE_PAUSE_BUCKETS];
+/* We only take the slow path in `lean_dec_ref_cold` if one of the features above is in use. */
+static atomic<bool> g_free_slow_path(false);
+/* In deferred-free mode, the clock is only read after freeing this many objects. */
+#define LEAN_DEFERRED_FREE_CLOCK_INTERVAL 256
+/* Maximum number of object graphs postponed by a thread. When a thread exceeds it, its whole backlog is freed
+   at once, so that the memory held by postponed graphs stays bounded even if the thread rarely frees objects. */
+#define LEAN_DEFERRED_FREE_MAX_BACKLOG 64
+
+static void update_free_slow_path() {
+    g_free_slow_path = g_deferred_free_budget_ns > 0 || g_free_pause_stats_users > 0;
+}
+
+/* Object graphs whose deletion has been postponed in deferred-free mode. Each entry is a `todo` list
+   as used in `lean_dec_ref_cold`. The lists are only accessed by the thread that created them. */
+typedef std::vector<object *> deferred_free_lists;
+LEAN_THREAD_PTR(deferred_free_lists, g_deferred_free_lists);
+
+static size_t free_todo_list(object * todo) {
+    size_t n = 0;
+    while (todo != nullptr) {
+        object * o = pop_back(todo);
+        lean_del_core(o, todo);
+        n++;
+    }
+    return n;
+}
+
+static void finalize_deferred_free_lists(void * p) {
+    deferred_free_lists * lists = reinterpret_cast<deferred_free_lists *>(p);
+    while (!lists->empty()) {
+        object * todo = lists->back();
+        lists->pop_back();
+        free_todo_list(todo);
+    }
+    delete lists;
+    g_deferred_free_lists = nullptr;
+}
+
+#if defined(LEAN_MULTI_THREAD)
+/* Thread freeing the postponed graphs of multi-threaded objects. Marking an object as multi-threaded also marks
+   all objects reachable from it, so these graphs do not contain objects whose reference counts are updated
+   non-atomically by other threads. */
+class deferred_free_thread {
+    mutex                 m_mutex;
+    condition_variable    m_queue_cv;
+    std::vector<object *> m_queue;
+    lthread *             m_thread{nullptr};
+    bool                  m_shutting_down{false};
+
+    void run() {
+        std::vector<object *> todo_lists;
+        while (true) {
+            {
+                unique_lock<mutex> lock(m_mutex);
+                while (m_queue.empty() && !m_shutting_down)
+                    m_queue_cv.wait(lock);
+                if (m_queue.empty())
+                    return;
+                std::swap(todo_lists, m_queue);
+            }
+            for (object * todo : todo_lists)
+                free_todo_list(todo);
+            todo_lists.clear();
+        }
+    }
+
+public:
+    ~deferred_free_thread() {
+        if (m_thread) {
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_shutting_down = true;
+            }
+            m_queue_cv.notify_one();
+            m_thread->join();
+            delete m_thread;
+        }
+    }
+
+    void push(object * todo) {
+        unique_lock<mutex> lock(m_mutex);
+        if (!m_thread)
+            m_thread = new lthread([this]() { run(); });
+        m_queue.push_back(todo);
+        lock.unlock();
+        m_queue_cv.notify_one();
+    }
+};
+
+static deferred_free_thread * g_deferred_free_thread = nullptr;
+#endif
+
+extern "C" LEAN_EXPORT size_t lean_free_deferred() {
+    size_t n = 0;
+    if (g_deferred_free_lists) {
+        while (!g_deferred_free_lists->empty()) {
+            object * todo = g_deferred_free_lists->back();
+            g_deferred_free_lists->pop_back();
+            n += free_todo_list(todo);
+        }
+    }
+    return n;
+}
+
+/* Postpone the deletion of the objects in `todo`. If `mt` is true, `todo` only contains multi-threaded objects. */
+static void defer_free(object * todo, bool mt) {
+#if defined(LEAN_MULTI_THREAD)
+    if (mt) {
+        g_deferred_free_thread->push(todo);
+        return;
+    }
+#else
+    (void)mt;
+#endif
+    if (!g_deferred_free_lists) {
+        g_deferred_free_lists = new deferred_free_lists();
+        register_thread_finalizer(finalize_deferred_free_lists, g_deferred_free_lists);
+    }
+    g_deferred_free_lists->push_back(todo);
+    if (g_deferred_free_lists->size() > LEAN_DEFERRED_FREE_MAX_BACKLOG)
+        lean_free_deferred();
+}
+
+static void record_free_pause(std::chrono::steady_clock::time_point start) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    unsigned i = 0;
+    while (i + 1 < LEAN_NUM_FREE_PAUSE_BUCKETS && (static_cast<uint64>(1) << i) <= static_cast<uint64>(us))
+        i++;
+    g_free_pause_histogram[i]++;
+}
+
+/* Slow path of `lean_dec_ref_cold` for freeing `o` in deferred-free mode and/or while collecting pause times.
+   In deferred-free mode, we stop freeing once `g_deferred_free_budget_ns` has elapsed, and postpone the deletion
+   of the rest of the graph. If `o` is a multi-threaded object, the rest is freed by `g_deferred_free_thread`.
+   Otherwise, it may contain pointers to single-threaded objects that are still shared with the current thread,
+   and it is freed by subsequent calls on the current thread using their remaining budget. */
+static void lean_del_slow(object * o, bool mt) {
+    uint64 budget_ns = atomic_load_explicit(&g_deferred_free_budget_ns, memory_order_relaxed);
+    bool stats       = g_free_pause_stats_users > 0;
+    std::chrono::steady_clock::time_point start;
+    if (stats || budget_ns > 0) start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::nanoseconds(budget_ns);
+    size_t n = 0;
+    auto out_of_budget = [&]() {
+        return budget_ns > 0 && ++n % LEAN_DEFERRED_FREE_CLOCK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline;
+    };
+    object * todo = nullptr;
+    while (true) {
+        lean_del_core(o, todo);
+        if (todo == nullptr)
+            break;
+        if (out_of_budget()) {
+            defer_free(todo, mt);
+            break;
+        }
+        o = pop_back(todo);
+    }
+    // use the remaining budget for making progress on the graphs previously postponed by this thread
+    if (budget_ns > 0 && todo == nullptr) {
+        while (g_deferred_free_lists && !g_deferred_free_lists->empty()) {
+            todo = g_deferred_free_lists->back();
+            g_deferred_free_lists->pop_back();
+            while (todo != nullptr && !out_of_budget()) {
+                o = pop_back(todo);
+                lean_del_core(o, todo);
+            }
+            if (todo != nullptr) {
+                g_deferred_free_lists->push_back(todo);
+                break;
+            }
+        }
+    }
+    if (stats) record_free_pause(start);
+}
+
+extern "C" LEAN_EXPORT void lean_set_deferred_free_budget(size_t budget_us) {
+    g_deferred_free_budget_ns = static_cast<uint64>(budget_us) * 1000;
+    update_free_slow_path();
+    if (budget_us == 0)
+        lean_free_deferred();
+}
+
+scoped_free_pause_stats::scoped_free_pause_stats() {
+    g_free_pause_stats_users++;
+    update_free_slow_path();
+}
+
+scoped_free_pause_stats::~scoped_free_pause_stats() {
+    g_free_pause_stats_users--;
+    update_free_slow_path();
+}
+
+void get_free_pause_histogram(uint64 * buckets) {
+    for (unsigned i = 0; i < LEAN_NUM_FREE_PAUSE_BUCKETS; i++)
+        buckets[i] = g_free_pause_histogram[i];
+}
+
 extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
     if (o->m_rc == 1 || std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1) {
 #ifdef LEAN_LAZY_RC
         push_back(g_to_free, o);
 #else
+        if (LEAN_UNLIKELY(atomic_load_explicit(&g_free_slow_path, memory_order_relaxed))) {
+            // the reference count of a multi-threaded object has been set to 0 above
+            lean_del_slow(o, o->m_rc == 0);
+            return;
+        }
         object * todo = nullptr;
         while (true) {
             lean_del_core(o, todo);
@@ -476,6 +728,12 @@ static obj_res mark_mt_fn(obj_arg o) {
     return lean_box(0);
 }
 
+/* Children that are scalars, or already multi-threaded or persistent, do not need to be visited. */
+static inline void push_mark_mt(buffer<object*> & todo, object * o) {
+    if (!lean_is_scalar(o) && lean_is_st(o))
+        todo.push_back(o);
+}
+
 extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
 #ifndef LEAN_MULTI_THREAD
     return;
@@ -493,7 +751,7 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
             if (tag <= LeanMaxCtorTag) {
                 object ** it  = lean_ctor_obj_cptr(o);
                 object ** end = it + lean_ctor_num_objs(o);
-                for (; it != end; ++it) todo.push_back(*it);
+                for (; it != end; ++it) push_mark_mt(todo, *it);
             } else {
                 switch (tag) {
                 case LeanScalarArray:
@@ -507,26 +765,26 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
                     break;
                 }
                 case LeanTask:
-                    todo.push_back(lean_task_get(o));
+                    push_mark_mt(todo, lean_task_get(o));
                     break;
                 case LeanClosure: {
                     object ** it  = lean_closure_arg_cptr(o);
                     object ** end = it + lean_closure_num_fixed(o);
-                    for (; it != end; ++it) todo.push_back(*it);
+                    for (; it != end; ++it) push_mark_mt(todo, *it);
                     break;
                 }
                 case LeanArray: {
                     object ** it  = lean_array_cptr(o);
                     object ** end = it + lean_array_size(o);
-                    for (; it != end; ++it) todo.push_back(*it);
+                    for (; it != end; ++it) push_mark_mt(todo, *it);
                     break;
                 }
                 case LeanThunk:
-                    if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
-                    if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
+                    if (object * c = lean_to_thunk(o)->m_closure) push_mark_mt(todo, c);
+                    if (object * v = lean_to_thunk(o)->m_value) push_mark_mt(todo, v);
                     break;
                 case LeanRef:
-                    if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
+                    if (object * v = lean_to_ref(o)->m_value) push_mark_mt(todo, v);
                     break;
                 default:
                     lean_unreachable();
@@ -542,6 +800,9 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
 
 LEAN_THREAD_PTR(lean_task_object, g_current_task_object);
 
+/* Protects the marking of task values as multi-threaded on first access, see `lean_task_get`. */
+static mutex * g_task_value_mt_mutex = nullptr;
+
 static lean_task_imp * alloc_task_imp(obj_arg c, unsigned prio, bool keep_alive) {
     lean_task_imp * imp = (lean_task_imp*)lean_alloc_small_object(sizeof(lean_task_imp));
     imp->m_closure     = c;
@@ -702,7 +963,10 @@ class task_manager {
         } else if (v != nullptr) {
             lean_assert(t->m_imp->m_closure == nullptr);
             handle_finished(t);
-            mark_mt(v);
+            /* We do not mark `v` as multi-threaded here, while holding `m_mutex`, but on first access (see
+               `lean_task_get`): this worker does not hold any other reference to `v`, so no other thread can
+               access it before that. Thus, results that are never read are not traversed at all. */
+            t->m_value_st = !lean_is_scalar(v) && lean_is_st(v);
             t->m_value = v;
             /* After the task has been finished and we propagated
                dependecies, we can release `m_imp` and keep just the value */
@@ -813,6 +1077,21 @@ public:
         }
     }
 
+    void resolve(lean_task_object * t, object * v) {
+        /* The caller of `resolve_pending_task` may still be using `v`, so we cannot delay marking it as in
+           `run_task`. We do it before acquiring `m_mutex`. */
+        mark_mt(v);
+        unique_lock<mutex> lock(m_mutex);
+        lean_assert(t->m_imp);
+        lean_assert(t->m_imp->m_closure == nullptr);
+        lean_assert(!t->m_imp->m_deleted);
+        handle_finished(t);
+        t->m_value = v;
+        free_task_imp(t->m_imp);
+        t->m_imp   = nullptr;
+        m_task_finished_cv.notify_all();
+    }
+
     void cancel(lean_task_object * t) {
         unique_lock<mutex> lock(m_mutex);
         if (t->m_imp)
@@ -894,6 +1173,7 @@ static lean_task_object * alloc_task(obj_arg c, unsigned prio, bool keep_alive)
     lean_set_task_header((lean_object*)o);
     o->m_value = nullptr;
     o->m_imp   = alloc_task_imp(c, prio, keep_alive);
+    o->m_value_st = 0;
     if (keep_alive)
         lean_inc_ref((lean_object*)o);
     return o;
@@ -904,9 +1184,33 @@ static lean_task_object * alloc_task(obj_arg v) {
     lean_set_st_header((lean_object*)o, LeanTask, 0);
     o->m_value = v;
     o->m_imp   = nullptr;
+    o->m_value_st = 0;
+    return o;
+}
+
+
+lean_task_object * mk_pending_task() {
+    if (!g_task_manager)
+        return nullptr;
+    lean_task_object * o = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
+    lean_set_task_header((lean_object*)o);
+    o->m_value = nullptr;
+    o->m_imp   = alloc_task_imp(nullptr, 0, /* keep_alive */ false);
+    o->m_value_st = 0;
+    // reference owned by the caller of `resolve_pending_task`
+    lean_inc_ref((lean_object*)o);
     return o;
 }
 
+void resolve_pending_task(lean_task_object * t, obj_arg v) {
+    if (!g_task_manager) {
+        // the task manager has already been finalized
+        lean_dec(v);
+        return;
+    }
+    g_task_manager->resolve(t, v);
+    lean_dec_ref((lean_object*)t);
+}
 
 extern "C" LEAN_EXPORT obj_res lean_task_spawn_core(obj_arg c, unsigned prio, bool keep_alive) {
     if (!g_task_manager) {
@@ -923,7 +1227,7 @@ extern "C" LEAN_EXPORT obj_res lean_task_pure(obj_arg a) {
 }
 
 static obj_res task_map_fn(obj_arg f, obj_arg t, obj_arg) {
-    b_obj_res v = lean_to_task(t)->m_value;
+    b_obj_res v = lean_task_get(t);
     lean_assert(v != nullptr);
     lean_inc(v);
     lean_dec_ref(t);
@@ -940,25 +1244,36 @@ extern "C" LEAN_EXPORT obj_res lean_task_map_core(obj_arg f, obj_arg t, unsigned
     }
 }
 
+static void mark_task_value_mt(lean_task_object * t) {
+    unique_lock<mutex> lock(*g_task_value_mt_mutex);
+    if (t->m_value_st) {
+        mark_mt(t->m_value);
+        t->m_value_st = 0;
+    }
+}
+
 extern "C" LEAN_EXPORT b_obj_res lean_task_get(b_obj_arg t) {
-    if (object * v = lean_to_task(t)->m_value)
-        return v;
-    g_task_manager->wait_for(lean_to_task(t));
-    lean_assert(lean_to_task(t)->m_value != nullptr);
     object * r = lean_to_task(t)->m_value;
+    if (!r) {
+        g_task_manager->wait_for(lean_to_task(t));
+        lean_assert(lean_to_task(t)->m_value != nullptr);
+        r = lean_to_task(t)->m_value;
+    }
+    if (lean_to_task(t)->m_value_st)
+        mark_task_value_mt(lean_to_task(t));
     return r;
 }
 
 static obj_res task_bind_fn2(obj_arg t, obj_arg) {
     lean_assert(lean_to_task(t)->m_value);
-    b_obj_res v = lean_to_task(t)->m_value;
+    b_obj_res v = lean_task_get(t);
     lean_inc(v);
     lean_dec_ref(t);
     return v;
 }
 
 static obj_res task_bind_fn1(obj_arg x, obj_arg f, obj_arg) {
-    b_obj_res v = lean_to_task(x)->m_value;
+    b_obj_res v = lean_task_get(x);
     lean_assert(v != nullptr);
     lean_inc(v);
     lean_dec_ref(x);
@@ -982,6 +1297,10 @@ extern "C" LEAN_EXPORT obj_res lean_task_bind_core(obj_arg x, obj_arg f, unsigne
     }
 }
 
+bool in_task_worker() {
+    return g_current_task_object != nullptr;
+}
+
 extern "C" LEAN_EXPORT bool lean_io_check_canceled_core() {
     if (lean_task_object * t = g_current_task_object) {
         lean_assert(t->m_imp); // task is being executed
@@ -1881,7 +2200,7 @@ extern "C" LEAN_EXPORT uint64 lean_string_hash(b_obj_arg s) {
 }
 
 // =======================================
-// ByteArray & FloatArray
+// ByteArray, FloatArray, and UIntNArray
 
 size_t lean_nat_to_size_t(obj_arg n) {
     if (lean_is_scalar(n)) {
@@ -1985,6 +2304,53 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     return r;
 }
 
+/* Bulk operations on scalar arrays. The loops below are written so that the C++ compiler vectorizes them.
+   Operations taking an owned array `a` update it in place if it is exclusive, and otherwise write the result
+   to a fresh array instead of copying `a` first. */
+
+static object * sarray_exclusive_or_alloc(object * a) {
+    if (lean_is_exclusive(a))
+        return a;
+    size_t sz = lean_sarray_size(a);
+    return lean_alloc_sarray(lean_sarray_elem_size(a), sz, sz);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_byte_array_fill(obj_arg a, uint8 v) {
+    object * r = sarray_exclusive_or_alloc(a);
+    memset(lean_sarray_cptr(r), v, lean_sarray_size(r));
+    if (r != a) lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT uint8 lean_byte_array_beq(b_obj_arg a, b_obj_arg b) {
+    size_t sz = lean_sarray_size(a);
+    return sz == lean_sarray_size(b) && memcmp(lean_sarray_cptr(a), lean_sarray_cptr(b), sz) == 0;
+}
+
+/* Lexicographic order, the result is the `Ordering` constructor index. */
+extern "C" LEAN_EXPORT uint8 lean_byte_array_compare(b_obj_arg a, b_obj_arg b) {
+    size_t asz = lean_sarray_size(a);
+    size_t bsz = lean_sarray_size(b);
+    int c = memcmp(lean_sarray_cptr(a), lean_sarray_cptr(b), std::min(asz, bsz));
+    if (c == 0)
+        return asz < bsz ? 0 : (asz == bsz ? 1 : 2);
+    return c < 0 ? 0 : 2;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_byte_array_index_of(b_obj_arg a, uint8 v, b_obj_arg start) {
+    size_t sz = lean_sarray_size(a);
+    if (!lean_is_scalar(start) || lean_unbox(start) >= sz)
+        return lean_usize_to_nat(sz);
+    uint8 const * it = lean_sarray_cptr(a);
+    size_t i = lean_unbox(start);
+    void const * p = memchr(it + i, v, sz - i);
+    return lean_usize_to_nat(p ? static_cast<uint8 const *>(p) - it : sz);
+}
+
+extern "C" LEAN_EXPORT uint64 lean_byte_array_hash(b_obj_arg a) {
+    return hash_str(lean_sarray_size(a), lean_sarray_cptr(a), 11);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_copy_float_array(obj_arg a) {
     return lean_copy_sarray(a, lean_sarray_capacity(a));
 }
@@ -2024,6 +2390,155 @@ extern "C" LEAN_EXPORT obj_res lean_float_array_push(obj_arg a, double d) {
     return r;
 }
 
+template<typename F> static obj_res float_array_map(obj_arg a, F && f) {
+    object * r = sarray_exclusive_or_alloc(a);
+    size_t sz = lean_sarray_size(a);
+    double const * src = lean_float_array_cptr(a);
+    double * dest = lean_float_array_cptr(r);
+    for (size_t i = 0; i < sz; i++)
+        dest[i] = f(src[i]);
+    if (r != a) lean_dec(a);
+    return r;
+}
+
+/* `a[i] := f(a[i], b[i])` for `i < min(size(a), size(b))`, the other elements of `a` are unchanged. */
+template<typename F> static obj_res float_array_zip_with(obj_arg a, b_obj_arg b, F && f) {
+    object * r = sarray_exclusive_or_alloc(a);
+    size_t sz = lean_sarray_size(a);
+    size_t n  = std::min(sz, lean_sarray_size(b));
+    double const * x = lean_float_array_cptr(a);
+    double const * y = lean_float_array_cptr(b);
+    double * dest = lean_float_array_cptr(r);
+    for (size_t i = 0; i < n; i++)
+        dest[i] = f(x[i], y[i]);
+    if (r != a) {
+        memcpy(dest + n, x + n, (sz - n) * sizeof(double)); // NOLINT
+        lean_dec(a);
+    }
+    return r;
+}
+
+/* Reduce `f(a[i], b[i])` using four independent accumulators, which allows the compiler to vectorize the loop.
+   Thus, the result of a floating point sum may differ in rounding from a sequential fold. */
+template<typename F, typename R> static double float_array_reduce(size_t n, double init, F && f, R && reduce) {
+    double acc[4] = { init, init, init, init };
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc[0] = reduce(acc[0], f(i));
+        acc[1] = reduce(acc[1], f(i+1));
+        acc[2] = reduce(acc[2], f(i+2));
+        acc[3] = reduce(acc[3], f(i+3));
+    }
+    for (; i < n; i++)
+        acc[0] = reduce(acc[0], f(i));
+    return reduce(reduce(acc[0], acc[1]), reduce(acc[2], acc[3]));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_fill(obj_arg a, double v) {
+    return float_array_map(a, [&](double) { return v; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_add(obj_arg a, b_obj_arg b) {
+    return float_array_zip_with(a, b, [](double x, double y) { return x + y; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_sub(obj_arg a, b_obj_arg b) {
+    return float_array_zip_with(a, b, [](double x, double y) { return x - y; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_mul(obj_arg a, b_obj_arg b) {
+    return float_array_zip_with(a, b, [](double x, double y) { return x * y; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_scale(obj_arg a, double c) {
+    return float_array_map(a, [&](double x) { return c * x; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_axpy(double c, b_obj_arg x, obj_arg y) {
+    return float_array_zip_with(y, x, [&](double v, double u) { return v + c * u; });
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_sum(b_obj_arg a) {
+    double const * it = lean_float_array_cptr(a);
+    return float_array_reduce(lean_sarray_size(a), 0.0,
+                              [&](size_t i) { return it[i]; },
+                              [](double s, double v) { return s + v; });
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_dot(b_obj_arg a, b_obj_arg b) {
+    double const * x = lean_float_array_cptr(a);
+    double const * y = lean_float_array_cptr(b);
+    return float_array_reduce(std::min(lean_sarray_size(a), lean_sarray_size(b)), 0.0,
+                              [&](size_t i) { return x[i] * y[i]; },
+                              [](double s, double v) { return s + v; });
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_min(b_obj_arg a) {
+    double const * it = lean_float_array_cptr(a);
+    return float_array_reduce(lean_sarray_size(a), INFINITY,
+                              [&](size_t i) { return it[i]; },
+                              [](double m, double v) { return v < m ? v : m; });
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_max(b_obj_arg a) {
+    double const * it = lean_float_array_cptr(a);
+    return float_array_reduce(lean_sarray_size(a), -INFINITY,
+                              [&](size_t i) { return it[i]; },
+                              [](double m, double v) { return m < v ? v : m; });
+}
+
+/* Shared implementation of `UIntNArray.mk`, `UIntNArray.data`, and `UIntNArray.push`. */
+template<typename T, T (*unbox)(b_obj_arg)>
+static obj_res scalar_array_mk(obj_arg a) {
+    usize sz      = lean_array_size(a);
+    obj_res r     = lean_alloc_sarray(sizeof(T), sz, sz); // NOLINT
+    object ** it  = lean_array_cptr(a);
+    object ** end = it + sz;
+    T * dest      = reinterpret_cast<T*>(lean_sarray_cptr(r));
+    for (; it != end; ++it, ++dest) {
+        *dest = unbox(*it);
+    }
+    lean_dec(a);
+    return r;
+}
+
+template<typename T, obj_res (*box)(T)>
+static obj_res scalar_array_data(obj_arg a) {
+    usize sz       = lean_sarray_size(a);
+    obj_res r      = lean_alloc_array(sz, sz);
+    T * it         = reinterpret_cast<T*>(lean_sarray_cptr(a));
+    T * end        = it+sz;
+    object ** dest = lean_array_cptr(r);
+    for (; it != end; ++it, ++dest) {
+        *dest = box(*it);
+    }
+    lean_dec(a);
+    return r;
+}
+
+template<typename T>
+static obj_res scalar_array_push(obj_arg a, T d) {
+    object * r = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(a, lean_sarray_size(a) + 1, /* exact */ false));
+    size_t & sz  = lean_to_sarray(r)->m_size;
+    T * it       = reinterpret_cast<T*>(lean_sarray_cptr(r)) + sz;
+    *it = d;
+    sz++;
+    return r;
+}
+
+static uint16 unbox_uint16(b_obj_arg o) { return lean_unbox(o); }
+static obj_res box_uint16(uint16 v) { return lean_box(v); }
+
+extern "C" LEAN_EXPORT obj_res lean_uint16_array_mk(obj_arg a) { return scalar_array_mk<uint16, unbox_uint16>(a); }
+extern "C" LEAN_EXPORT obj_res lean_uint16_array_data(obj_arg a) { return scalar_array_data<uint16, box_uint16>(a); }
+extern "C" LEAN_EXPORT obj_res lean_uint16_array_push(obj_arg a, uint16 d) { return scalar_array_push(a, d); }
+extern "C" LEAN_EXPORT obj_res lean_uint32_array_mk(obj_arg a) { return scalar_array_mk<uint32, lean_unbox_uint32>(a); }
+extern "C" LEAN_EXPORT obj_res lean_uint32_array_data(obj_arg a) { return scalar_array_data<uint32, lean_box_uint32>(a); }
+extern "C" LEAN_EXPORT obj_res lean_uint32_array_push(obj_arg a, uint32 d) { return scalar_array_push(a, d); }
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_mk(obj_arg a) { return scalar_array_mk<uint64, lean_unbox_uint64>(a); }
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_data(obj_arg a) { return scalar_array_data<uint64, lean_box_uint64>(a); }
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_push(obj_arg a, uint64 d) { return scalar_array_push(a, d); }
+
 // =======================================
 // Array functions for generated code
 
@@ -2181,13 +2696,30 @@ extern "C" LEAN_EXPORT lean_external_class * lean_register_external_class(lean_e
 void initialize_object() {
     g_ext_classes       = new std::vector<external_object_class*>();
     g_ext_classes_mutex = new mutex();
+    g_task_value_mt_mutex = new mutex();
+    g_foreign_sarrays_mutex = new mutex();
+    g_foreign_sarrays   = new std::unordered_map<object *, foreign_sarray>();
     g_array_empty       = lean_alloc_array(0, 0);
     mark_persistent(g_array_empty);
+#if defined(LEAN_MULTI_THREAD)
+    g_deferred_free_thread = new deferred_free_thread();
+#endif
+#ifndef LEAN_EMSCRIPTEN
+    if (char const * budget = std::getenv("LEAN_DEFERRED_FREE")) {
+        lean_set_deferred_free_budget(atoi(budget));
+    }
+#endif
 }
 
 void finalize_object() {
     for (external_object_class * cls : *g_ext_classes) delete cls;
     delete g_ext_classes;
     delete g_ext_classes_mutex;
+    delete g_task_value_mt_mutex;
+    delete g_foreign_sarrays;
+    delete g_foreign_sarrays_mutex;
+#if defined(LEAN_MULTI_THREAD)
+    delete g_deferred_free_thread;
+#endif
 }
 }
@@ -219,6 +219,10 @@ inline void sarray_set_size(u_obj_arg o, size_t sz) { lean_sarray_set_size(o, sz
 inline unsigned sarray_elem_size(object * o) { return lean_sarray_elem_size(o); }
 inline size_t sarray_capacity(object * o) { return lean_sarray_capacity(o); }
 inline uint8 * sarray_cptr(object * o) { return lean_sarray_cptr(o); }
+/* Register the scalar array `o` whose memory was not allocated by the Lean allocator, e.g., a memory mapped file.
+   When `o` is freed, `finalize(data)` is invoked instead of deallocating `o`.
+   The data of `o` must be aligned to 4096 bytes. */
+void register_foreign_sarray(object * o, void (*finalize)(void *), void * data);
 
 // =======================================
 // ByteArray
@@ -272,6 +276,30 @@ inline obj_res thunk_pure(obj_arg v) { return lean_thunk_pure(v); }
 inline b_obj_res thunk_get(b_obj_arg t) { return lean_thunk_get(t); }
 inline obj_res thunk_get_own(b_obj_arg t) { return lean_thunk_get_own(t); }
 
+/* Deferred-free mode: when the budget is not zero, `lean_dec_ref_cold` spends at most about `budget_us`
+   microseconds freeing an object graph. The rest of a large graph of multi-threaded objects is freed by a
+   background thread, and the rest of other graphs incrementally by subsequent calls on the same thread.
+   A thread frees all its postponed graphs at once when their number exceeds a fixed bound.
+   Thus, finalizers of external objects (e.g., file handles) may be postponed in this mode.
+   It can also be enabled by setting the environment variable `LEAN_DEFERRED_FREE` to the budget.
+   Disabling the mode frees the graphs postponed by the current thread. */
+extern "C" LEAN_EXPORT void lean_set_deferred_free_budget(size_t budget_us);
+/* Free all object graphs whose deletion has been postponed by the current thread,
+   and return the number of objects freed. */
+extern "C" LEAN_EXPORT size_t lean_free_deferred();
+
+#define LEAN_NUM_FREE_PAUSE_BUCKETS 24
+/* While an object of this class is alive, the time spent freeing object graphs in `lean_dec_ref_cold`
+   is recorded in a histogram. */
+class scoped_free_pause_stats {
+public:
+    scoped_free_pause_stats();
+    ~scoped_free_pause_stats();
+};
+/* Store the histogram of pause times in `buckets`. Bucket `i` counts the pauses shorter than `2^i`
+   microseconds that do not fit into a smaller bucket, the last bucket counts all longer pauses. */
+void get_free_pause_histogram(uint64 * buckets);
+
 // =======================================
 // Tasks
 
@@ -287,6 +315,17 @@ inline obj_res task_bind(obj_arg x, obj_arg f, unsigned prio = 0, bool keep_aliv
 inline obj_res task_map(obj_arg f, obj_arg t, unsigned prio = 0, bool keep_alive = false) { return lean_task_map_core(f, t, prio, keep_alive); }
 inline b_obj_res task_get(b_obj_arg t) { return lean_task_get(t); }
 
+/* Create a task that is not run by the task manager but finished by `resolve_pending_task`,
+   e.g. when an external event occurs. Returns `nullptr` if there is no task manager.
+   The pending task holds an extra reference that is released by `resolve_pending_task`. */
+lean_task_object * mk_pending_task();
+/* Finish pending task `t` with value `v`, and schedule the tasks depending on it. */
+void resolve_pending_task(lean_task_object * t, obj_arg v);
+
+/* Return true if the current thread is executing a task. Blocking on another task from there may deadlock if all
+   workers are busy. */
+bool in_task_worker();
+
 inline bool io_check_canceled_core() { return lean_io_check_canceled_core(); }
 inline void io_cancel_core(b_obj_arg t) { return lean_io_cancel_core(t); }
 inline bool io_has_finished_core(b_obj_arg t) { return lean_io_has_finished_core(t); }
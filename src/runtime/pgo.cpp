@@ -0,0 +1,48 @@
+/*
+Copyright (c) 2026 Lean contributors. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <lean/lean.h>
+
+namespace lean {
+/* Translation units compiled with `lean --profile-instrument`. We use a lock-free linked list because
+   `lean_prof_register` is invoked by static constructors, possibly before the ones of the runtime, and possibly
+   concurrently when shared libraries are loaded by different threads. The list is never shrunk. */
+static std::atomic<lean_prof_module *> g_prof_modules(nullptr);
+
+static void write_profile() {
+    char const * fname = std::getenv("LEAN_PROFILE_FILE");
+    if (fname == nullptr)
+        fname = "default.leanprof";
+    FILE * out = std::fopen(fname, "a");
+    if (out == nullptr) {
+        std::fprintf(stderr, "failed to write profile '%s'\n", fname);
+        return;
+    }
+    for (lean_prof_module * m = g_prof_modules.load(); m != nullptr; m = m->m_next) {
+        for (size_t i = 0; i < m->m_size; i++) {
+            lean_prof_entry const & e = m->m_entries[i];
+            for (size_t j = 0; j < e.m_size; j++) {
+                // counter 0 is always written so that functions that were never called are in the profile
+                uint64_t c = e.m_counters[j].load(std::memory_order_relaxed);
+                if (j == 0 || c != 0)
+                    std::fprintf(out, "%s %zu %llu\n", e.m_name, j, static_cast<unsigned long long>(c));
+            }
+        }
+    }
+    std::fclose(out);
+}
+
+extern "C" LEAN_EXPORT void lean_prof_register(lean_prof_module * m) {
+    lean_prof_module * head = g_prof_modules.load();
+    do {
+        m->m_next = head;
+    } while (!g_prof_modules.compare_exchange_weak(head, m));
+    // exactly one registration observes the empty list
+    if (head == nullptr)
+        std::atexit(write_profile);
+}
+}
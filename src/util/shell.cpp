@@ -9,6 +9,7 @@ Author: Leonardo de Moura
 #include <signal.h>
 #include <cctype>
 #include <cstdlib>
+#include <cstdio>
 #include <string>
 #include <utility>
 #include <vector>
@@ -32,6 +33,7 @@ Author: Leonardo de Moura
 #include "library/module.h"
 #include "library/time_task.h"
 #include "library/compiler/ir.h"
+#include "library/compiler/csimp.h"
 #include "library/trace.h"
 #include "library/print.h"
 #include "initialize/init.h"
@@ -172,6 +174,9 @@ using namespace lean; // NOLINT
 #ifndef LEAN_SERVER_DEFAULT_MAX_HEARTBEAT
 #define LEAN_SERVER_DEFAULT_MAX_HEARTBEAT 100000
 #endif
+#ifndef LEAN_MAX_C_SHARDS
+#define LEAN_MAX_C_SHARDS 256
+#endif
 
 static void display_header(std::ostream & out) {
     out << "Lean (version " << get_version_string() << ", " << LEAN_STR(LEAN_BUILD_TYPE) << ")\n";
@@ -187,6 +192,13 @@ static void display_help(std::ostream & out) {
     std::cout << "  --o=oname -o       create olean file\n";
     std::cout << "  --i=iname -i       create ilean file\n";
     std::cout << "  --c=fname -c       name of the C output file\n";
+    std::cout << "  --c-shards=num     split the C output into a header, a main file, and num files with the function\n"
+              << "                     definitions (fname.h, fname.c, fname.1.c, ...) that can be compiled in parallel;\n"
+              << "                     num must be between 1 and " << LEAN_MAX_C_SHARDS << "\n";
+    std::cout << "  --profile-instrument  make the C output count function calls and branches, and write the counts to\n"
+              << "                     $LEAN_PROFILE_FILE (default: default.leanprof) at exit\n";
+    std::cout << "  --profile-use=file use the counts in file, written by an instrumented program, for inlining and\n"
+              << "                     generating C code\n";
     std::cout << "  --stdin            take input from stdin\n";
     std::cout << "  --root=dir         set package root directory from which the module name of the input file is calculated\n"
               << "                     (default: current working directory)\n";
@@ -237,6 +249,9 @@ static struct option g_long_options[] = {
     {"deps-json",    no_argument,       0, 'J'},
     {"timeout",      optional_argument, 0, 'T'},
     {"c",            optional_argument, 0, 'c'},
+    {"c-shards",     required_argument, 0, 'N'},
+    {"profile-instrument", no_argument, 0, 'G'},
+    {"profile-use",  required_argument, 0, 'U'},
     {"exitOnPanic",  no_argument,       0, 'e'},
 #if defined(LEAN_MULTI_THREAD)
     {"threads",      required_argument, 0, 'j'},
@@ -404,6 +419,43 @@ extern "C" object* lean_environment_free_regions(object * env, object * w);
 void environment_free_regions(environment && env) {
     consume_io_result(lean_environment_free_regions(env.steal(), io_mk_world()));
 }
+
+/* Write the C file `fn` unless it already contains `contents`. Unchanged files keep their modification time,
+   so build systems do not recompile them. In particular, when a module is split into shards (`--c-shards`),
+   changing a function usually only changes the shard containing it. Return false if the file cannot be written. */
+bool write_c_file(std::string const & fn, char const * contents, options const & opts) {
+    std::ifstream in(fn, std::ios_base::binary);
+    if (in.good()) {
+        std::stringstream buf;
+        buf << in.rdbuf();
+        if (buf.str() == contents) {
+            if (get_profiler(opts))
+                report_profiling_counter("C files unchanged", 1);
+            return true;
+        }
+    }
+    in.close();
+    std::ofstream out(fn, std::ios_base::binary);
+    if (out.fail()) {
+        std::cerr << "failed to create '" << fn << "'\n";
+        return false;
+    }
+    out << contents;
+    out.close();
+    if (get_profiler(opts))
+        report_profiling_counter("C files written", 1);
+    return true;
+}
+
+/* Remove the shards `base.K.c` with `K > num_shards` left over from a previous run with more shards,
+   so that build systems compiling all `base.*.c` files do not pick up stale definitions. */
+void remove_stale_c_shards(std::string const & base, unsigned num_shards) {
+    for (unsigned k = num_shards + 1;; k++) {
+        std::string fn = base + "." + std::to_string(k) + ".c";
+        if (std::remove(fn.c_str()) != 0)
+            break;
+    }
+}
 }
 
 extern "C" object * lean_get_prefix(object * w);
@@ -476,6 +528,9 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     optional<std::string> server_in;
     std::string native_output;
     optional<std::string> c_output;
+    unsigned c_shards = 0;
+    bool profile_instrument = false;
+    std::string profile_data;
     optional<std::string> root_dir;
     buffer<string_ref> forwarded_args;
 
@@ -506,6 +561,29 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 check_optarg("c");
                 c_output = optarg;
                 break;
+            case 'N': {
+                char * end = nullptr;
+                unsigned long n = std::strtoul(optarg, &end, 10);
+                if (!std::isdigit(static_cast<unsigned char>(*optarg)) || *end != '\0' || n < 1 || n > LEAN_MAX_C_SHARDS) {
+                    std::cerr << "error: invalid value '" << optarg << "' for option '--c-shards', expected a number between 1 and "
+                              << LEAN_MAX_C_SHARDS << std::endl;
+                    return 1;
+                }
+                c_shards = static_cast<unsigned>(n);
+                break;
+            }
+            case 'G':
+                profile_instrument = true;
+                break;
+            case 'U':
+                try {
+                    profile_data = read_file(optarg);
+                    lean::set_profile_data(profile_data);
+                } catch (lean::throwable & ex) {
+                    std::cerr << ex.what() << "\n";
+                    return 1;
+                }
+                break;
             case 's':
                 lean::lthread::set_thread_stack_size(
                         static_cast<size_t>((atoi(optarg) / 4) * 4) * static_cast<size_t>(1024));
@@ -709,15 +787,27 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             write_module(env, *olean_fn);
         }
 
-        if (c_output && ok) {
-            std::ofstream out(*c_output, std::ios_base::binary);
-            if (out.fail()) {
-                std::cerr << "failed to create '" << *c_output << "'\n";
-                return 1;
+        std::string c_base = c_output ? *c_output : std::string();
+        if (c_base.size() > 2 && c_base.compare(c_base.size() - 2, 2, ".c") == 0)
+            c_base = c_base.substr(0, c_base.size() - 2);
+        if (c_output && ok && c_shards > 0) {
+            time_task _("C code generation", opts);
+            std::string header_fn = c_base + ".h";
+            std::string header_name = header_fn.substr(header_fn.find_last_of("/\\") + 1);
+            array_ref<string_ref> files = lean::ir::emit_c_shards(env, *main_module_name, header_name, c_shards,
+                                                                            profile_instrument, profile_data);
+            for (size_t i = 0; i < files.size(); i++) {
+                std::string fn = i == 0 ? header_fn : i == 1 ? *c_output : c_base + "." + std::to_string(i - 1) + ".c";
+                if (!write_c_file(fn, files[i].data(), opts))
+                    return 1;
             }
+            remove_stale_c_shards(c_base, c_shards);
+        } else if (c_output && ok) {
             time_task _("C code generation", opts);
-            out << lean::ir::emit_c(env, *main_module_name).data();
-            out.close();
+            string_ref out = lean::ir::emit_c(env, *main_module_name, profile_instrument, profile_data);
+            if (!write_c_file(*c_output, out.data(), opts))
+                return 1;
+            remove_stale_c_shards(c_base, 0);
         }
 
         display_cumulative_profiling_times(std::cerr);
@@ -0,0 +1,56 @@
+/-
+Benchmark for closure application: a small parser-combinator style interpreter whose
+combinators are closures stored in data structures, and a generic monadic loop that is
+not specialized to the `StateT`/`ReaderT` stack it runs in.
+-/
+
+abbrev P := String.Iterator → Option String.Iterator
+
+def satisfy (p : Char → Bool) : P := fun it =>
+  if !it.atEnd && p it.curr then some it.next else none
+
+def seq (p q : P) : P := fun it =>
+  match p it with
+  | some it => q it
+  | none    => none
+
+def alt (p q : P) : P := fun it =>
+  match p it with
+  | some it => some it
+  | none    => q it
+
+partial def many (p : P) : P := fun it =>
+  match p it with
+  | some it' => many p it'
+  | none     => some it
+
+def token : P :=
+  alt (seq (satisfy Char.isDigit) (many (satisfy Char.isDigit)))
+      (alt (seq (satisfy Char.isAlpha) (many (satisfy Char.isAlphanum)))
+           (satisfy (· == ' ')))
+
+partial def countTokens (it : String.Iterator) (n : Nat) : Nat :=
+  match token it with
+  | some it => countTokens it (n + 1)
+  | none    => if it.atEnd then n else countTokens it.next n
+
+@[noinline] def loopM {m : Type → Type} [Monad m] (step : Nat → m Unit) : Nat → m Unit
+  | 0   => pure ()
+  | n+1 => do step n; loopM step n
+
+abbrev M := StateT Nat (ReaderT Nat Id)
+
+def main : List String → IO UInt32
+  | [n] => do
+    let n := n.toNat!
+    let mut s := ""
+    for _ in [0:n] do
+      s := s ++ "foo 42 bar7 1984 baz "
+    IO.println (countTokens s.iter 0)
+    let step : Nat → M Unit := fun i => do
+      let k ← read
+      modify fun acc => (acc + i * k) % 1000000007
+    let ((), acc) := (loopM step (n * 20)).run 0 |>.run 3
+    IO.println acc
+    return 0
+  | _ => return 1
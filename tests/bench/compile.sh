@@ -1,4 +1,5 @@
 #!/usr/bin/env bash
 source ../common.sh
 
-compile_lean
+# extra `lean` and `leanc` flags can be passed in `BENCH_LEAN_OPTS` and `BENCH_LEANC_OPTS`
+compile_lean ${BENCH_LEANC_OPTS:-}
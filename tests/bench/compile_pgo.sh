@@ -0,0 +1,8 @@
+#!/usr/bin/env bash
+source ../common.sh
+
+# compile with a profile collected by running the program on the arguments in `$f.args`, see `Lean.IR.Profile`
+BENCH_LEAN_OPTS=--profile-instrument compile_lean
+rm -f "$f.leanprof"
+LEAN_PROFILE_FILE="$f.leanprof" "./$f.out" $(cat "$f.args") > /dev/null || fail "Failed to run $f.out"
+BENCH_LEAN_OPTS="--profile-use=$f.leanprof" compile_lean
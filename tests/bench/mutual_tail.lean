@@ -0,0 +1,40 @@
+/-
+Benchmark for mutually tail-recursive functions: a tokenizer state machine whose states are
+functions tail-calling each other once per input character.
+-/
+
+mutual
+partial def space (s : String) (i : String.Pos) (words nums : Nat) : Nat × Nat :=
+  if s.atEnd i then (words, nums)
+  else
+    let c := s.get i
+    if c.isDigit then number s (s.next i) words (nums + 1)
+    else if c.isAlpha then word s (s.next i) (words + 1) nums
+    else space s (s.next i) words nums
+
+partial def word (s : String) (i : String.Pos) (words nums : Nat) : Nat × Nat :=
+  if s.atEnd i then (words, nums)
+  else
+    let c := s.get i
+    if c.isAlpha then word s (s.next i) words nums
+    else if c.isDigit then number s (s.next i) words (nums + 1)
+    else space s (s.next i) words nums
+
+partial def number (s : String) (i : String.Pos) (words nums : Nat) : Nat × Nat :=
+  if s.atEnd i then (words, nums)
+  else
+    let c := s.get i
+    if c.isDigit then number s (s.next i) words nums
+    else if c.isAlpha then word s (s.next i) (words + 1) nums
+    else space s (s.next i) words nums
+end
+
+def main : List String → IO UInt32
+  | [n] => do
+    let mut s := ""
+    for _ in [0:n.toNat!] do
+      s := s ++ "lorem 42 ipsum7 dolor 1984, "
+    let (words, nums) := space s 0 0 0
+    IO.println s!"{words} {nums}"
+    return 0
+  | _ => return 1
@@ -0,0 +1,28 @@
+/-
+Contention benchmark for `IO.Ref`s shared between tasks: each of `n` tasks increments
+a shared counter `k` times using `modify` (take/set), `modifyLockFree` and `compareAndSwap`.
+-/
+
+partial def casIncr (r : IO.Ref Nat) : IO Unit := do
+  let v ← r.get
+  unless (← r.compareAndSwap v (v + 1)) do
+    casIncr r
+
+def run (name : String) (n k : Nat) (incr : IO.Ref Nat → IO Unit) : IO Unit := do
+  let r ← IO.mkRef 0
+  let tasks ← (List.range n).mapM fun _ => IO.asTask (prio := Task.Priority.dedicated) do
+    for _ in [0:k] do
+      incr r
+  for t in tasks do
+    IO.ofExcept (← IO.wait t)
+  IO.println s!"{name}: {← r.get}"
+
+def main : List String → IO UInt32
+  | [n, k] => do
+    let n := n.toNat!
+    let k := k.toNat!
+    run "modify" n k fun r => r.modify (· + 1)
+    run "modifyLockFree" n k fun r => r.modifyLockFree (· + 1)
+    run "compareAndSwap" n k casIncr
+    return 0
+  | _ => return 1
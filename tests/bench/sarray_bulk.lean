@@ -0,0 +1,58 @@
+/-
+Bulk operations on `FloatArray` and `ByteArray`. Each operation is applied `k` times to arrays of size `n`,
+once using the runtime primitive and once using an element-wise loop.
+-/
+
+def mkFloats (n : Nat) : FloatArray := Id.run do
+  let mut a := FloatArray.mkEmpty n
+  for i in [0:n] do
+    a := a.push (i % 100).toFloat
+  return a
+
+def mkBytes (n : Nat) : ByteArray := Id.run do
+  let mut a := ByteArray.mkEmpty n
+  for _ in [0:n] do
+    a := a.push 1
+  return a.push 0
+
+def loopAxpy (c : Float) (x : FloatArray) (y : FloatArray) : FloatArray := Id.run do
+  let mut y := y
+  for i in [0:y.size] do
+    y := y.set! i (y.get! i + c * x.get! i)
+  return y
+
+def bench (name : String) (k : Nat) (f : Unit → α) (toStr : α → String) : IO Unit := do
+  let start ← IO.monoMsNow
+  let mut r := f ()
+  for _ in [1:k] do
+    r := f ()
+  IO.println s!"{name}: {toStr r} ({(← IO.monoMsNow) - start}ms)"
+
+def main : List String → IO UInt32
+  | [n, k] => do
+    let n := n.toNat!
+    let k := k.toNat!
+    let xs := mkFloats n
+    let bs := mkBytes n
+    let bs' := bs.copySlice 0 ByteArray.empty 0 bs.size
+    let mut y := mkFloats n
+    let start ← IO.monoMsNow
+    for _ in [0:k] do
+      y := FloatArray.axpy 0.5 xs y
+    IO.println s!"axpy: {y.sum} ({(← IO.monoMsNow) - start}ms)"
+    let start ← IO.monoMsNow
+    for _ in [0:k] do
+      y := loopAxpy 0.5 xs y
+    IO.println s!"axpy loop: {y.sum} ({(← IO.monoMsNow) - start}ms)"
+    bench "sum" k (fun _ => xs.sum) toString
+    bench "sum loop" k (fun _ => xs.foldl (· + ·) 0) toString
+    bench "dot" k (fun _ => xs.dot xs) toString
+    bench "max" k (fun _ => xs.max) toString
+    bench "max loop" k (fun _ => xs.foldl (fun m v => if m < v then v else m) 0) toString
+    bench "indexOf" k (fun _ => bs.indexOf 0) toString
+    bench "indexOf loop" k (fun _ => (bs.findIdx? (· == 0)).getD bs.size) toString
+    bench "beq" k (fun _ => bs == bs') toString
+    bench "beq loop" k (fun _ => bs.data == bs'.data) toString
+    bench "hash" k (fun _ => hash bs) toString
+    return 0
+  | _ => return 1
@@ -0,0 +1,44 @@
+/-
+Benchmark for publishing large task results, modeled after the snapshot pipeline of the language
+server: each of `n` rounds spawns a task building a tree of `k` nodes on top of the previous
+snapshot, and only some of the snapshots are ever read.
+-/
+
+inductive Tree where
+  | leaf
+  | node (l : Tree) (key : Nat) (val : String) (r : Tree)
+
+def Tree.insert : Tree → Nat → String → Tree
+  | leaf, k, v => node leaf k v leaf
+  | node l k' v' r, k, v =>
+    if k < k' then node (l.insert k v) k' v' r
+    else if k' < k then node l k' v' (r.insert k v)
+    else node l k v r
+
+def Tree.size : Tree → Nat
+  | leaf => 0
+  | node l _ _ r => l.size + 1 + r.size
+
+def build (base : Tree) (round k : Nat) : Tree := Id.run do
+  let mut t := base
+  for i in [0:k] do
+    let key := (i * 7919 + round * 104729) % 1000003
+    t := t.insert key (toString key)
+  return t
+
+def main : List String → IO UInt32
+  | [n, k] => do
+    let n := n.toNat!
+    let k := k.toNat!
+    let mut snap := Task.pure Tree.leaf
+    let mut snaps := #[]
+    for round in [0:n] do
+      snap := snap.map fun t => build t round k
+      snaps := snaps.push snap
+    -- only every fourth snapshot is inspected, the others are superseded
+    let mut total := 0
+    for i in [0:snaps.size:4] do
+      total := total + snaps[i]!.get.size
+    IO.println s!"{total}"
+    return 0
+  | _ => return 1
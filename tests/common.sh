@@ -21,7 +21,7 @@ shift
 [ $# -eq 0 ] || fail "Usage: test_single.sh [-i] test-file.lean"
 
 function compile_lean {
-    lean --c="$f.c" "$f" || fail "Failed to compile $f into C file"
+    lean ${BENCH_LEAN_OPTS:-} --c="$f.c" "$f" || fail "Failed to compile $f into C file"
     leanc -O3 -DNDEBUG -o "$f.out" "$@" "$f.c" || fail "Failed to compile C file $f.c"
 }
 
@@ -0,0 +1,6 @@
+import Main.Lib
+
+set_option compiler.borrowExported true
+
+def main : IO Unit :=
+  IO.println (count [1, 2, 2, 3] 2)
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# When the ownership summary of an `@[export]` function changes (`compiler.borrowExported`), importing modules must be
+# recompiled: here `count._borrowed` disappears, and a stale `Main.c` would fail to link.
+set -euo pipefail
+
+mkdir -p Main
+write_lib() {
+    cat > Main/Lib.lean <<LEAN
+set_option compiler.borrowExported true
+
+@[export test_summary_rebuild_count]
+def count (xs : List Nat) (x : Nat) : Nat :=
+  $1
+LEAN
+}
+
+rm -rf build marker
+# `xs` and `x` are borrowed
+write_lib 'xs.foldl (fun n y => if x == y then n + 1 else n) 0'
+leanmake bin
+grep -q '_borrowed' build/temp/Main.c || { echo "Main does not call the borrowed version"; exit 1; }
+[ "$(./build/bin/Main)" == "2" ] || { echo "unexpected output"; exit 1; }
+
+sleep 1
+touch marker
+# `xs` and `x` are now stored in the result, so there is no borrowed version anymore
+write_lib '(x :: xs).length'
+leanmake bin
+[ build/Main.olean -nt marker ] || { echo "Main was not recompiled after the summary changed"; exit 1; }
+grep -q '_borrowed' build/temp/Main.c && { echo "Main still calls the borrowed version"; exit 1; }
+[ "$(./build/bin/Main)" == "5" ] || { echo "unexpected output after the summary changed"; exit 1; }
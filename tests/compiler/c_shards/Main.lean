@@ -0,0 +1,20 @@
+def fib : Nat → Nat
+  | 0 => 0
+  | 1 => 1
+  | n+2 => fib n + fib (n+1)
+
+mutual
+def isEven : Nat → Bool
+  | 0 => true
+  | n+1 => isOdd n
+def isOdd : Nat → Bool
+  | 0 => false
+  | n+1 => isEven n
+end
+
+def table : Array String :=
+  (List.range 5).toArray.map fun i => s!"{i}:{fib i}"
+
+def main : IO Unit := do
+  IO.println (table.toList)
+  IO.println (isEven 10, isOdd 10)
@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# A module split into C shards (`--c-shards`) must build, link and run with `leanmake C_SHARDS=N`,
+# and shards left over from a larger N must be removed.
+set -euo pipefail
+
+expected='[0:0, 1:1, 2:1, 3:2, 4:3]
+(true, false)'
+
+rm -rf build
+leanmake -j4 bin C_SHARDS=3
+for i in 1 2 3; do
+    [ -f build/temp/Main.$i.c ] || { echo "missing shard Main.$i.c"; exit 1; }
+done
+[ "$(./build/bin/Main)" == "$expected" ] || { echo "unexpected output with 3 shards"; exit 1; }
+
+touch Main.lean
+leanmake -j4 bin C_SHARDS=2
+[ -f build/temp/Main.3.c ] && { echo "stale shard Main.3.c was not removed"; exit 1; }
+[ "$(./build/bin/Main)" == "$expected" ] || { echo "unexpected output with 2 shards"; exit 1; }
+
+touch Main.lean
+leanmake bin
+[ "$(./build/bin/Main)" == "$expected" ] || { echo "unexpected output without shards"; exit 1; }
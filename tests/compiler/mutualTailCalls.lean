@@ -0,0 +1,24 @@
+mutual
+def isEven : Nat → Bool
+  | 0   => true
+  | n+1 => isOdd n
+def isOdd : Nat → Bool
+  | 0   => false
+  | n+1 => isEven n
+end
+
+-- three states with different numbers of parameters
+mutual
+partial def stateA (n : UInt64) (acc : UInt64) : UInt64 :=
+  if n == 0 then acc else stateB (n - 1) acc (n % 3)
+partial def stateB (n : UInt64) (acc : UInt64) (k : UInt64) : UInt64 :=
+  if k == 0 then stateC (n, acc + 1) else stateA n (acc + k)
+partial def stateC (p : UInt64 × UInt64) : UInt64 :=
+  stateA p.1 p.2
+end
+
+def main : IO Unit := do
+  -- deep enough to overflow the stack unless mutual tail calls are jumps
+  IO.println (isEven 10000000)
+  IO.println (isOdd 10000001)
+  IO.println (stateA 10000000 0)
@@ -0,0 +1,16 @@
+-- the `else` branch is taken 99 times more often than the `then` branch
+@[noinline] def classify (n : Nat) : Nat :=
+  if n % 100 == 0 then n / 100 else n + 1
+
+-- only called when arguments are given, which the test script never does
+@[noinline] def rarely (n : Nat) : Nat :=
+  n * 3 + 1
+
+-- too big to be inlined without a profile, but small and hot enough to be inlined with one
+def step (acc i : Nat) : Nat :=
+  acc + i * 2 + 1
+
+def main (args : List String) : IO Unit := do
+  let r := (List.range 1000).foldl (fun acc i => step acc i + classify i) 0
+  let r := if args.isEmpty then r else rarely r
+  IO.println r
@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+# Compile `Main.lean` with `--profile-instrument`, run it to collect a profile, and check that
+# `--profile-use` turns the profile into inlining decisions, branch hints and cold functions in the C output.
+set -euo pipefail
+
+rm -f Main.leanprof
+lean --profile-instrument --c=Main.instr.c Main.lean
+leanc -O3 -DNDEBUG -o Main.instr.out Main.instr.c
+LEAN_PROFILE_FILE=Main.leanprof ./Main.instr.out > Main.instr.produced.out
+grep -q "^l_classify 0 1000$" Main.leanprof || { echo "missing call count of 'classify'"; exit 1; }
+grep -q "^l_rarely 0 0$" Main.leanprof || { echo "missing call count of 'rarely'"; exit 1; }
+grep -q "^l_step 0 1000$" Main.leanprof || { echo "missing call count of 'step'"; exit 1; }
+grep "l_step(" Main.instr.c | grep -qv "^LEAN_EXPORT" || { echo "'step' is not called in Main.instr.c"; exit 1; }
+
+lean --profile-use=Main.leanprof --c=Main.c Main.lean
+grep -q "LEAN_UNLIKELY\|LEAN_LIKELY" Main.c || { echo "no branch hint in Main.c"; exit 1; }
+grep -q "^LEAN_COLD .*l_rarely(" Main.c || { echo "'rarely' is not cold in Main.c"; exit 1; }
+grep -q "^LEAN_COLD .*l_classify(" Main.c && { echo "'classify' is cold in Main.c"; exit 1; }
+grep "l_step(" Main.c | grep -qv "^LEAN_EXPORT" && { echo "'step' is not inlined in Main.c"; exit 1; }
+leanc -O3 -DNDEBUG -o Main.out Main.c
+./Main.out > Main.produced.out
+diff Main.instr.produced.out Main.produced.out
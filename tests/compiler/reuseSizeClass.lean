@@ -0,0 +1,35 @@
+set_option compiler.reuseSizeClass true
+
+inductive Term where
+  | var (n : Nat)
+  | app (f a : Term)
+  | lam (body : Term)
+
+/-- A different type whose nodes have the same size classes as the ones of `Term`. -/
+inductive Code where
+  | ref (n : Nat)
+  | call (f a : Code)
+  | closure (depth : UInt64) (body : Code)
+
+def Term.toCode (depth : UInt64) : Term → Code
+  | .var n   => .ref n
+  | .app f a => .call (f.toCode depth) (a.toCode depth)
+  | .lam b   => .closure depth (b.toCode (depth + 1))
+
+def Code.size : Code → Nat
+  | .ref _         => 1
+  | .call f a      => f.size + a.size + 1
+  | .closure d b   => b.size + d.toNat
+
+/-- `List` cells reused as `Prod` cells and vice versa. -/
+def pairs : List Nat → List (Nat × Nat)
+  | a :: b :: as => (a, b) :: pairs as
+  | _            => []
+
+def mkTerm : Nat → Term
+  | 0   => .var 0
+  | n+1 => if n % 2 == 0 then .lam (mkTerm n) else .app (mkTerm n) (.var n)
+
+def main : IO Unit := do
+  IO.println ((mkTerm 20).toCode 0).size
+  IO.println (pairs (List.range 10))
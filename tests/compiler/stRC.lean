@@ -0,0 +1,15 @@
+structure P where
+  a : Array Nat
+  b : Nat
+
+@[noinline] def spawnSum (p : P) : Task Nat :=
+  Task.spawn fun _ => p.a.foldl (· + ·) p.b
+
+def main : IO Unit := do
+  let mut acc := 0
+  for i in [0:1000] do
+    let p : P := { a := #[i, i+1], b := i }
+    let t₁ := spawnSum p
+    let t₂ := spawnSum p
+    acc := acc + t₁.get + t₂.get + p.a.size
+  IO.println acc
@@ -0,0 +1,23 @@
+structure Acc where
+  sum   : Nat
+  count : UInt32
+  name  : String
+
+@[noinline] def mkAcc (n : Nat) : Acc :=
+  { sum := n, count := n.toUInt32, name := toString n }
+
+def step (a : Acc) (i : Nat) : Acc :=
+  let p := (a.sum + i, a.name)
+  let o : Option Nat := if i % 3 == 0 then some i else none
+  let extra := match o with
+    | some k => k
+    | none   => 0
+  { sum := p.1 + extra, count := a.count + 1, name := p.2 }
+
+def loop : Nat → Acc → Acc
+  | 0,   a => a
+  | n+1, a => loop n (step a n)
+
+def main : IO Unit := do
+  let a := loop 1000 (mkAcc 7)
+  IO.println s!"{a.sum} {a.count} {a.name}"
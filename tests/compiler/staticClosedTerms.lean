@@ -0,0 +1,22 @@
+structure Config where
+  name  : String
+  tags  : Array String
+  level : Nat
+  opt   : Option (List Nat)
+
+def defaultConfig : Config :=
+  { name := "défault", tags := #["a", "bc", ""], level := 3, opt := some [1, 2, 3] }
+
+def emptyTags : Array String := #[]
+
+def configs : List Config :=
+  [defaultConfig, { defaultConfig with name := "other", tags := emptyTags }]
+
+def main : IO Unit := do
+  for c in configs do
+    IO.println s!"{c.name} {c.name.length} {c.tags} {c.level} {c.opt}"
+  -- static objects are persistent, so updates must copy them
+  let c := { defaultConfig with tags := defaultConfig.tags.push "d" }
+  IO.println c.tags
+  IO.println defaultConfig.tags
+  IO.println (emptyTags.push "x").size
@@ -0,0 +1,2 @@
+def main : IO Unit :=
+  IO.println "hello"
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+# Rebuilding a module whose C output does not change must keep the C file and its modification time,
+# both with `lean --c` and with `leanmake`, so that the C compiler is not run again.
+set -euo pipefail
+
+rm -rf build direct.c marker
+lean --c=direct.c Main.lean
+leanmake bin
+sleep 1
+touch marker Main.lean
+
+lean --c=direct.c Main.lean
+[ direct.c -nt marker ] && { echo "'lean --c' rewrote an unchanged C file"; exit 1; }
+
+leanmake bin
+[ build/Main.olean -nt marker ] || { echo "Main.lean was not recompiled"; exit 1; }
+[ build/temp/Main.c -nt marker ] && { echo "leanmake rewrote an unchanged C file"; exit 1; }
+[ build/temp/Main.o -nt marker ] && { echo "leanmake recompiled an unchanged C file"; exit 1; }
+[ -f build/temp/Main.c.tmp ] && { echo "leftover temporary C file"; exit 1; }
+./build/bin/Main
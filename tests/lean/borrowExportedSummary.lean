@@ -0,0 +1,13 @@
+set_option compiler.borrowExported true
+set_option trace.compiler.ir.borrow_summary true
+
+@[export test_borrow_exported_summary_count]
+def count (xs : List Nat) (x : Nat) : Nat :=
+  match xs with
+  | []      => 0
+  | y :: ys => (if x == y then 1 else 0) + count ys x
+
+-- `a` and `b` are stored in the result, so the two declarations are merged again and no summary is reported
+@[export test_borrow_exported_summary_mk]
+def mkPair (a : String) (b : String) : String × String :=
+  (a, b)
@@ -115,4 +115,72 @@ check_eq "1" [] ys.toList
 let ys ← withFile fn4 Mode.read $ fun h => h.read 1;
 check_eq "2" [] ys.toList
 
-#eval test4
\ No newline at end of file
+#eval test4
+
+def test5 : IO Unit := do
+let fn5 := "foo5.txt"
+let line := "".pushn 'α' 3000
+withFile fn5 Mode.write fun h => do
+  h.putStrLn line
+  h.putStr "end"
+let ys ← withFile fn5 Mode.read fun h => do
+  let _ ← h.getLine
+  h.readBinToEnd
+check_eq "1" "end".toUTF8.toList ys.toList
+let s ← withFile fn5 Mode.read fun h => h.readToEnd
+check_eq "2" (line ++ "\nend") s
+let h ← Handle.mkBuffered fn5 Mode.read 16
+check_eq "3" (line ++ "\n") (← h.getLine)
+let bs ← h.mmap
+check_eq "4" (← readBinFile fn5).toList bs.toList
+check_eq "5" "end" (← h.readToEnd)
+let bs' := bs.set! 0 0
+check_eq "6" (← readBinFile fn5).toList bs.toList
+check_eq "7" (0 : UInt8) (bs'.get! 0)
+-- `readToEnd` and `readFile` do not validate their input
+withFile fn5 Mode.write fun h => h.write (ByteArray.mk #[97, 0xC0, 0x80, 10, 98])
+check_eq "8" true ((← (withFile fn5 Mode.read fun h => h.readToEnd).toBaseIO) matches .ok _)
+check_eq "9" true ((← (readFile fn5).toBaseIO) matches .ok _)
+
+#eval test5
+
+def test6 : IO Unit := do
+let r ← IO.mkRef 1
+check_eq "1" false (← r.compareAndSwap 2 3)
+check_eq "2" true (← r.compareAndSwap 1 3)
+check_eq "3" 3 (← r.get)
+check_eq "4" 3 (← r.modifyGetLockFree fun v => (v, v + 1))
+check_eq "5" 4 (← r.get)
+let tasks ← (List.range 4).mapM fun _ => IO.asTask do
+  for _ in [0:1000] do
+    r.modifyLockFree (· + 1)
+for t in tasks do
+  IO.ofExcept (← IO.wait t)
+check_eq "6" 4004 (← r.get)
+
+#eval test6
+
+/-- Return `true` if the UTF-8 encoding of `s` occurs in `bs`. -/
+def containsBytes (bs : ByteArray) (s : String) : Bool :=
+  let needle := s.toUTF8
+  (List.range (bs.size + 1 - needle.size)).any fun i => bs.extract i (i + needle.size) == needle
+
+@[noinline] def allocStrings (n : Nat) : List String :=
+  (List.range n).map fun i => toString i
+
+def test7 : IO Unit := do
+let fn7 := "foo7.pb"
+-- the sampler is only available if Lean was compiled with `ALLOC_SAMPLER=ON`
+if (← (startAllocSampler 16).toBaseIO) matches .error _ then
+  return
+let xs := allocStrings 10000
+check_eq "1" 10000 xs.length
+stopAllocSampler fn7
+let pb ← readBinFile fn7
+-- the string table of the profile contains the sample types and the interpreted allocating function
+check_eq "2" true (containsBytes pb "alloc_space")
+check_eq "3" true (containsBytes pb "inuse_space")
+check_eq "4" true (containsBytes pb "allocStrings")
+check_eq "5" true ((← (stopAllocSampler fn7).toBaseIO) matches .error _)
+
+#eval test7
@@ -0,0 +1,20 @@
+set_option compiler.borrowExported true
+
+@[export test_borrow_exported_count]
+def count (xs : List Nat) (x : Nat) : Nat :=
+  match xs with
+  | []      => 0
+  | y :: ys => (if x == y then 1 else 0) + count ys x
+
+@[export test_borrow_exported_mk]
+def mkPair (a : String) (b : String) : String × String :=
+  (a, b)
+
+def useCount (xs : List Nat) : Nat :=
+  count xs 1 + count xs 2 + xs.length
+
+#eval useCount [1, 2, 2, 3]
+#eval [[1, 1], [2]].map (count · 1)
+#eval (mkPair "a" "b").2
+
+#guard useCount [1, 2, 2, 3] == 7
@@ -0,0 +1,14 @@
+set_option compiler.borrowExported true
+set_option trace.compiler.ir.borrow_rc_stats true
+
+@[export test_borrow_rc_stats_count]
+def count (xs : List Nat) (x : Nat) : Nat :=
+  match xs with
+  | []      => 0
+  | y :: ys => (if x == y then 1 else 0) + count ys x
+
+-- the calls to `count` do not need to increment `xs`
+def useCount (xs : List Nat) : Nat :=
+  count xs 1 + count xs 2 + xs.length
+
+#guard useCount [1, 2, 2, 3] == 7
@@ -0,0 +1,67 @@
+import Lean
+
+/- The same blocks are compiled sequentially in `Seq` and in parallel in `Par`. The command line environment is
+   single-threaded, so this checks that the parallel path is taken and that its results are merged in block order. -/
+
+namespace Seq
+set_option compiler.parallel false
+
+mutual
+def isEven : Nat → Bool
+  | 0   => true
+  | n+1 => isOdd n
+def isOdd : Nat → Bool
+  | 0   => false
+  | n+1 => isEven n
+end
+
+mutual
+partial def collatzA (n : Nat) (steps : Nat) : Nat :=
+  if n ≤ 1 then steps else if n % 2 == 0 then collatzB (n / 2) (steps + 1) else collatzB (3 * n + 1) (steps + 1)
+partial def collatzB (n : Nat) (steps : Nat) : Nat :=
+  collatzA n steps
+partial def sums (xs : List Nat) : List (Nat → Nat) :=
+  xs.map fun x y => collatzA (x + y) 0 + x * x
+end
+
+end Seq
+
+namespace Par
+set_option compiler.parallel true
+
+mutual
+def isEven : Nat → Bool
+  | 0   => true
+  | n+1 => isOdd n
+def isOdd : Nat → Bool
+  | 0   => false
+  | n+1 => isEven n
+end
+
+mutual
+partial def collatzA (n : Nat) (steps : Nat) : Nat :=
+  if n ≤ 1 then steps else if n % 2 == 0 then collatzB (n / 2) (steps + 1) else collatzB (3 * n + 1) (steps + 1)
+partial def collatzB (n : Nat) (steps : Nat) : Nat :=
+  collatzA n steps
+partial def sums (xs : List Nat) : List (Nat → Nat) :=
+  xs.map fun x y => collatzA (x + y) 0 + x * x
+end
+
+end Par
+
+#eval do
+  unless Par.isEven 100 && Par.isOdd 7 do throw <| IO.userError "isEven"
+  unless Par.collatzA 27 0 == 111 do throw <| IO.userError "collatz"
+  unless (Par.sums [1, 2]).map (· 1) == (Seq.sums [1, 2]).map (· 1) do throw <| IO.userError "sums"
+
+open Lean in
+/-- The IR of all declarations generated in namespace `ns`, in the order they were added. -/
+def irIn (ns : Name) : CoreM (List String) := do
+  let decls := IR.getDecls (← getEnv) |>.filter (ns.isPrefixOf ·.name)
+  return decls.reverse.map fun d => (toString d).replace s!"{ns}." ""
+
+#eval show Lean.CoreM Unit from do
+  let seq ← irIn `Seq
+  let par ← irIn `Par
+  unless seq.length > 6 do throw <| IO.userError s!"missing declarations: {seq.length}"
+  unless seq == par do throw <| IO.userError s!"parallel compilation differs:\n{seq}\n{par}"
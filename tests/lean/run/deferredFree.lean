@@ -0,0 +1,29 @@
+def mkList (n : Nat) : List (Option Nat) :=
+  (List.range n).map some
+
+@[noinline] def len (xs : List (Option Nat)) : Nat :=
+  xs.length
+
+def test (size : Nat) : IO Unit := do
+  IO.setDeferredFreeBudget 1
+  -- dropping the list frees objects for at most about 1 microsecond, the rest is postponed
+  let n := len (mkList size)
+  unless n == size do throw <| IO.userError "unexpected length"
+  let freed ← IO.freeDeferred
+  unless freed > 0 do throw <| IO.userError "nothing was postponed"
+  unless (← IO.freeDeferred) == 0 do throw <| IO.userError "postponed objects were not freed"
+  -- the backlog is freed when too many graphs have been postponed
+  for i in [0:100] do
+    let n := len (mkList (size + i))
+    unless n == size + i do throw <| IO.userError "unexpected length"
+  let freed ← IO.freeDeferred
+  unless freed ≤ 64 * 2 * (size + 100) do throw <| IO.userError s!"backlog is not bounded: {freed}"
+  IO.setDeferredFreeBudget 0
+  -- pauses are recorded while `allocprof` is running
+  let hist ← IO.allocprof "free pauses" do
+    let n := len (mkList size)
+    unless n == size do throw <| IO.userError "unexpected length"
+    IO.getFreePauseHistogram
+  unless hist.foldl (· + ·) 0 > 0 do throw <| IO.userError "no pause was recorded"
+
+#eval test 100000
@@ -0,0 +1,32 @@
+/-- Exchange data with `cat` through `stdin` and `stdout`. All the waits on `stdin` have finished when this
+function returns. -/
+def exchange (stdin : IO.FS.Handle) (stdout : IO.FS.Handle) : IO Unit := do
+  let line ← stdout.getLineAsync
+  -- the line arrives in two parts
+  let w ← stdin.writeAsync "hel".toUTF8
+  let _ ← IO.ofExcept (← IO.wait w)
+  stdin.flush
+  IO.sleep 50
+  stdin.putStr "lo\n"
+  stdin.flush
+  let line ← IO.ofExcept (← IO.wait line)
+  unless line == "hello\n" do
+    throw <| IO.userError s!"unexpected line: {line}"
+  -- fewer bytes than requested are available: the read returns them instead of waiting for more
+  let bytes ← stdout.readAsync 100
+  stdin.putStr "world"
+  stdin.flush
+  let bytes ← IO.ofExcept (← IO.wait bytes)
+  unless bytes.toList == "world".toUTF8.toList do
+    throw <| IO.userError s!"unexpected bytes: {bytes}"
+
+def test : IO Unit := do
+  let child ← IO.Process.spawn { cmd := "cat", stdin := .piped, stdout := .piped }
+  let (stdin, child) ← child.takeStdin
+  exchange stdin child.stdout
+  /- `Handle` has no `close` operation: a handle is closed when its last reference is released. The event
+     loop has released its references once the waits finished, and `stdin` is not used below, so it is
+     closed here and `cat` terminates. -/
+  let _ ← child.wait
+
+#eval test
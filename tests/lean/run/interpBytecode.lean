@@ -0,0 +1,32 @@
+set_option interpreter.bytecode true
+
+structure P where
+  x : UInt64
+  y : Float
+  b : Bool
+  n : Nat
+
+def sumTR (n acc : Nat) : Nat :=
+  match n with
+  | 0 => acc
+  | n+1 => sumTR n (acc + n)
+
+def classify (n : Nat) : String :=
+  let s := if n % 2 == 0 then "even" else "odd"
+  if n > 10 then s ++ " big" else s
+
+def scale (p : P) (k : UInt64) : P :=
+  { p with x := p.x * k, y := p.y * 2.5, b := !p.b }
+
+def table : List Nat := [1, 2, 3]
+
+def test : IO Unit := do
+  unless sumTR 100000 0 == 4999950000 do throw <| IO.userError "sumTR"
+  unless (List.range 12).map classify |>.getLast! == "odd big" do throw <| IO.userError "classify"
+  let p := scale { x := 3, y := 1.0, b := false, n := 7 } 5
+  unless p.x == 15 && p.y == 2.5 && p.b && p.n == 7 do throw <| IO.userError "scale"
+  let f := fun (k : Nat) => table.map (· + k)
+  unless f 10 == [11, 12, 13] do throw <| IO.userError "closure"
+  unless (table.foldl (· + ·) 0) == 6 do throw <| IO.userError "const"
+
+#eval test
@@ -0,0 +1,27 @@
+def fib : Nat → Nat
+  | 0 => 0
+  | 1 => 1
+  | n+2 => fib n + fib (n+1)
+
+def sumTo : Nat → Nat
+  | 0 => 0
+  | n+1 => (n+1) + sumTo n
+
+#eval do
+  if ← System.FilePath.pathExists "interpProfile.folded" then IO.FS.removeFile "interpProfile.folded"
+  if ← System.FilePath.pathExists "interpProfile.folded.functions" then IO.FS.removeFile "interpProfile.folded.functions"
+
+set_option interpreter.profile "interpProfile.folded" in
+#eval fib 22
+
+-- a deep call tree is written without recursing per node
+set_option interpreter.profile "interpProfile.folded" in
+#eval sumTo 5000
+
+#eval do
+  let fns ← IO.FS.readFile "interpProfile.folded.functions"
+  -- each interpreted call of `fib` is counted
+  unless (fns.splitOn "\n").any (·.startsWith "fib\t57313 calls") do throw <| IO.userError fns
+  unless (fns.splitOn "\n").any (·.startsWith "sumTo\t5001 calls") do throw <| IO.userError fns
+  IO.FS.removeFile "interpProfile.folded"
+  IO.FS.removeFile "interpProfile.folded.functions"
@@ -0,0 +1,22 @@
+import Lean
+
+def c : Nat := (List.range 1000).foldl (· + ·) 0
+def s : String := String.join ((List.range 10).map toString)
+
+#eval c
+#eval s
+
+-- the environment changed, so the constants are now served from the shared cache
+def d := 1
+
+#eval show IO Unit from do
+  let hits ← Lean.getInterpreterSharedCacheHits
+  unless c + d == 499501 do throw <| IO.userError "c"
+  unless s == "0123456789" do throw <| IO.userError "s"
+  unless (← Lean.getInterpreterSharedCacheHits) > hits do throw <| IO.userError "no shared cache hits"
+
+set_option interpreter.bytecode true in
+#eval show IO Unit from do
+  let hits ← Lean.getInterpreterSharedCacheHits
+  unless c + d == 499501 do throw <| IO.userError "c"
+  unless (← Lean.getInterpreterSharedCacheHits) > hits do throw <| IO.userError "no shared cache hits"
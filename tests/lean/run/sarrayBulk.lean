@@ -0,0 +1,39 @@
+def bs := "hello world".toUTF8
+
+#guard bs.indexOf 'o'.toNat.toUInt8 == 4
+#guard bs.indexOf 'o'.toNat.toUInt8 5 == 7
+#guard bs.indexOf 'z'.toNat.toUInt8 == bs.size
+#guard bs.indexOf 'h'.toNat.toUInt8 100 == bs.size
+#guard bs == "hello world".toUTF8
+#guard bs != "hello".toUTF8
+#guard compare "hello".toUTF8 bs == .lt
+#guard compare bs "hello".toUTF8 == .gt
+#guard compare "b".toUTF8 "abc".toUTF8 == .gt
+#guard compare bs bs == .eq
+#guard hash bs == hash "hello world"
+#guard (bs.fill 7).toList == List.replicate 11 7
+
+def xs : FloatArray := [1.0, 2.0, 3.0, 4.0, 5.0].toFloatArray
+def ys : FloatArray := [10.0, 20.0].toFloatArray
+
+#guard xs.sum == 15
+#guard xs.dot ys == 50
+#guard xs.min == 1 && xs.max == 5
+#guard FloatArray.empty.min == 1 / 0 && FloatArray.empty.max == -1 / 0
+#guard (xs.add ys).toList == [11, 22, 3, 4, 5]
+#guard (ys.sub xs).toList == [9, 18]
+#guard (xs.mul ys).toList == [10, 40, 3, 4, 5]
+#guard (xs.scale 2).toList == [2, 4, 6, 8, 10]
+#guard (FloatArray.axpy 2 ys xs).toList == [21, 42, 3, 4, 5]
+#guard (xs.fill 0.5).sum == 2.5
+
+-- Shared arguments are not modified.
+def tst : IO Unit := do
+  let zs := xs.scale 3
+  IO.println xs
+  IO.println zs
+  let ws := ys.fill 1
+  IO.println ys
+  IO.println ws
+
+#eval tst
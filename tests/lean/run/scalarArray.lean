@@ -0,0 +1,47 @@
+def tst : IO Unit := do
+  let as := [(1 : UInt32), 2, 3].toUInt32Array
+  let as := as.push 4000000000
+  let as := as.set! 1 20
+  IO.println as
+  let as₁ := as.set! 2 30
+  IO.println as₁
+  IO.println as
+  IO.println as.size
+  let bs := [(65535 : UInt16), 7].toUInt16Array
+  IO.println (bs.push 8)
+  let cs := [(0xFFFFFFFFFFFFFFFF : UInt64)].toUInt64Array
+  IO.println (cs.get! 0)
+  IO.println (cs.get! 5)
+
+#eval tst
+
+@[specialize] def sumAll [ScalarArray γ α] [Add α] [OfNat α 0] (a : γ) : α :=
+  (ScalarArray.toList a).foldl (· + ·) 0
+
+#eval sumAll ((ScalarArray.ofList [1, 2, 3] : UInt32Array))
+#eval sumAll ((ScalarArray.ofList [1, 2, 3] : UInt64Array))
+#eval sumAll ((ScalarArray.ofList [1.5, 2.5] : FloatArray))
+
+example : (ScalarArray.toList (ScalarArray.ofList [(1 : UInt16), 2] : UInt16Array)) = [1, 2] := by
+  native_decide
+
+example : (ScalarArray.toArray (ScalarArray.ofArray #[(1 : UInt32), 2, 3] : UInt32Array)) = #[1, 2, 3] := by
+  native_decide
+
+def fill (n : Nat) : UInt32Array := Id.run do
+  let mut a := UInt32Array.mkEmpty n
+  for i in [0:n] do
+    a := a.push i.toUInt32
+  return a
+
+#eval ScalarArray.foldl (init := (0 : Nat)) (fun s v => s + v.toNat) (fill 1000)
+
+def sumFor (a : UInt64Array) : UInt64 := Id.run do
+  let mut s := 0
+  for v in a do
+    s := s + v
+  return s
+
+#guard sumFor (ScalarArray.ofList [1, 2, 3]) == 6
+#guard ScalarArray.get? ([(5 : UInt16)].toUInt16Array) 1 == none
+#guard ScalarArray.foldl (· + ·) 0 (fill 10) (start := 2) (stop := 100) == 44
@@ -0,0 +1,44 @@
+structure Particle where
+  x    : Float
+  y    : Float
+  id   : UInt32
+  kind : UInt8
+  deriving SoA, Repr
+
+def mkParticles (n : Nat) : Particle.SoA := Id.run do
+  let mut ps := SoA.mkEmpty n
+  for i in [0:n] do
+    ps := SoA.push ps { x := i.toFloat, y := 2 * i.toFloat, id := i.toUInt32, kind := (i % 3).toUInt8 }
+  return ps
+
+-- Only the `x` column is touched.
+def moveAll (ps : Particle.SoA) (dx : Float) : Particle.SoA := Id.run do
+  let mut xs := ps.x
+  for i in [0:xs.size] do
+    xs := xs.set! i (xs.get! i + dx)
+  return { ps with x := xs }
+
+def tst : IO Unit := do
+  let ps := mkParticles 10
+  IO.println (SoA.size ps)
+  IO.println (repr (SoA.get! ps 4))
+  let ps := SoA.set! ps 4 { x := 0.5, y := 0.25, id := 100, kind := 7 : Particle }
+  IO.println (repr (SoA.get! ps 4))
+  IO.println ps.id
+  let ps := moveAll ps 1
+  IO.println ps.x
+  IO.println (SoA.foldl (fun s p => s + p.kind.toNat) 0 ps)
+  let as := SoA.toArray ps
+  IO.println as.size
+  let qs : Particle.SoA := SoA.ofArray as
+  IO.println (qs.y.data == ps.y.data)
+
+#eval tst
+
+structure Pair where
+  a : UInt64
+  b : UInt16
+  deriving SoA
+
+example : SoA.size (SoA.push (SoA.empty : Pair.SoA) ⟨1, 2⟩) = 1 := by
+  native_decide
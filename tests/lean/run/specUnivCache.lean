@@ -0,0 +1,57 @@
+universe u
+
+def countAll {α : Type u} (xss : List (List α)) : Nat := Id.run do
+  let mut n := 0
+  for xs in xss do
+    n := n + xs.length
+  return n
+
+def countAllNat (xss : List (List Nat)) : Nat := Id.run do
+  let mut n := 0
+  for xs in xss do
+    n := n + xs.length
+  return n
+
+def mapOpt {α : Type u} (xs : List α) : Option (List α) :=
+  xs.mapM some
+
+#eval countAll [[1, 2], [3]]
+#eval countAllNat [[1, 2], [3]]
+#eval mapOpt [1, 2, 3]
+#guard countAll [["a"], ["b", "c"]] == 3
+
+/-! Specializations in declarations that differ only in the names of their universe parameters share a cache entry,
+  but a `Prop` instantiation does not share it with the polymorphic one. -/
+
+class Weight (α : Sort u) where
+  weight : α → Nat
+
+instance punitWeight : Weight PUnit.{u} := ⟨fun _ => 1⟩
+
+@[specialize] def totalWeight {α : Sort u} [Weight α] (n : Nat) (a : α) : Nat :=
+  match n with
+  | 0     => 0
+  | n + 1 => Weight.weight a + totalWeight n a
+
+universe v w
+
+def polyWeight (b : PUnit.{v}) : Nat := totalWeight 10 b
+def polyWeight' (b : PUnit.{w}) : Nat := totalWeight 10 b
+def propWeight (b : PUnit.{0}) : Nat := totalWeight 10 b
+
+open Lean Compiler in
+#eval show CoreM Unit from do
+  let entries := (specExtension.getState (← getEnv)).cache.toList.filter fun (key, _) =>
+    key.getAppFn.isConstOf ``totalWeight
+  let levelsOf (key : Expr) := key.getAppFn.constLevels!
+  let some (_, poly) := entries.find? (levelsOf ·.1 == [mkLevelParam `_u_1])
+    | throwError "no canonical polymorphic entry in {entries.map (·.1)}"
+  let some (_, prop) := entries.find? (levelsOf ·.1 == [levelZero])
+    | throwError "no Prop entry in {entries.map (·.1)}"
+  if poly == prop then
+    throwError "Prop and polymorphic instantiations share {poly}"
+  if entries.any (fun (key, _) => levelsOf key == [mkLevelParam `v] || levelsOf key == [mkLevelParam `w]) then
+    throwError "universe parameters were not canonicalized in {entries.map (·.1)}"
+
+#guard polyWeight PUnit.unit == 10
+#guard polyWeight' PUnit.unit == 10
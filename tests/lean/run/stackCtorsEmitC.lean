@@ -0,0 +1,38 @@
+import Lean
+open Lean IR
+
+/-- `inc x_1; let x_2 := ctor_0[Prod.mk] x_1 x_1; let x_3 := proj[0] x_2; inc x_3; dec x_2; ret x_3` -/
+def projDecl : Decl :=
+  let x₁ : VarId := ⟨1⟩
+  let x₂ : VarId := ⟨2⟩
+  let x₃ : VarId := ⟨3⟩
+  let c : CtorInfo := { name := ``Prod.mk, cidx := 0, size := 2, usize := 0, ssize := 0 }
+  .fdecl `projTest #[{ x := x₁, borrow := false, ty := .object }] .object
+    (.inc x₁ 1 true false <|
+     .vdecl x₂ .object (.ctor c #[.var x₁, .var x₁]) <|
+     .vdecl x₃ .object (.proj 0 x₂) <|
+     .inc x₃ 1 true false <|
+     .dec x₂ 1 true false <|
+     .ret (.var x₃))
+    {}
+
+#guard projDecl.collectStackCtors.contains ⟨2⟩
+
+/-- `n` objects of 248 bytes each that are only released again. -/
+def bigCtorsDecl (n : Nat) : Decl :=
+  let x₁ : VarId := ⟨1⟩
+  let c : CtorInfo := { name := `Big, cidx := 0, size := 30, usize := 0, ssize := 0 }
+  let body := (List.range n).foldl (init := FnBody.ret (.var x₁)) fun b i =>
+    .inc x₁ 30 true false <| .vdecl ⟨i + 2⟩ .object (.ctor c (mkArray 30 (.var x₁))) <| .dec ⟨i + 2⟩ 1 true false b
+  .fdecl `bigCtorsTest #[{ x := x₁, borrow := false, ty := .object }] .object body {}
+
+-- the total size of the stack allocated objects of a function is bounded by `StackAlloc.maxStackCtorsSize`
+#guard (bigCtorsDecl 3).collectStackCtors.size == 3
+#guard (bigCtorsDecl 8).collectStackCtors.size == 4
+
+-- the C code of `projTest` allocates `x_2` on the stack
+#eval show CoreM Unit from do
+  let env := declMapExt.addEntry (← getEnv) projDecl
+  let c ← IO.ofExcept (emitC env `stackCtorsEmitC false "")
+  unless (c.splitOn "lean_alloc_stack_ctor").length > 1 && (c.splitOn "lean_free_stack_ctor(x_2)").length > 1 do
+    throw <| IO.userError c